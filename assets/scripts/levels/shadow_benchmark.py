@@ -0,0 +1,10 @@
+from Engine import Engine
+
+# Spreads every light out into an even grid when the level loads. Each of these lights casts
+# shadows, so their shadows all have to be rebuilt, a few at a time each frame.
+def OnLevelLoaded():
+    overworld = Engine.OverworldState()
+    for index in range(300):
+        column = 3 + (index % 20) * 5
+        row = 3 + (index // 20) * 5
+        overworld.SetLightPosition("Shadow Light " + str(index), column * 64 + 32, row * 64 + 32)
@@ -19,6 +19,10 @@ public:
     // This is local-world positioning. These values aren't changed by camera shifting.
     float levelX, levelY;
 
+    // The center of this Renderable in level space.
+    float levelOriginX() { return levelX + (destinationRect.w / 2); }
+    float levelOriginY() { return levelY + (destinationRect.h / 2); }
+
     // Size value grabbers.
     virtual float w() { return destinationRect.w; }
     virtual float h() { return destinationRect.h; }
@@ -51,6 +55,10 @@ public:
     // Color modifier for this Renderable. This could be multiple things such as lighting, tints, etc.
     SDL_Color colorModifier;
 
+    // The light falling on this Renderable, worked out every frame it's visible. This is applied
+    // to its texture when it's drawn.
+    SDL_Color lighting = { 255, 255, 255, 255 };
+
     // Scale modifier for this Renderable.
     float scaleMultiplier = 1.0;
 };
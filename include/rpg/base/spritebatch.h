@@ -0,0 +1,97 @@
+#pragma once
+#ifndef SPRITEBATCH_H
+#define SPRITEBATCH_H
+
+#include "SDL/SDL.h"
+#include <vector>
+
+// Collects sprites that share the same texture and sends them to the renderer in one
+// SDL_RenderGeometry call, instead of one SDL_RenderCopyF call per sprite. Each sprite
+// has its own color, so things like lighting don't need SDL_SetTextureColorMod.
+class SpriteBatch
+{
+public:
+    // Starts collecting sprites for this renderer.
+    void Begin(SDL_Renderer* ren)
+    {
+        renderer = ren;
+        texture = nullptr;
+        drawCalls = 0;
+        vertices.clear();
+        indices.clear();
+    };
+
+    // Adds a sprite to the batch. If this sprite uses a different texture to the sprites
+    // we already have, everything we have so far gets drawn first.
+    void Add(SDL_Texture* spriteTexture, const SDL_Rect& source, const SDL_FRect& destination, SDL_Color color)
+    {
+        if (spriteTexture == nullptr) return;
+
+        if (spriteTexture != texture)
+        {
+            Flush();
+            texture = spriteTexture;
+
+            int w, h;
+            SDL_QueryTexture(texture, NULL, NULL, &w, &h);
+            textureWidth = (float)w;
+            textureHeight = (float)h;
+        }
+
+        // Texture coordinates are from 0 to 1.
+        float u1 = source.x / textureWidth;
+        float v1 = source.y / textureHeight;
+        float u2 = (source.x + source.w) / textureWidth;
+        float v2 = (source.y + source.h) / textureHeight;
+
+        float x1 = destination.x;
+        float y1 = destination.y;
+        float x2 = destination.x + destination.w;
+        float y2 = destination.y + destination.h;
+
+        // Two triangles make up our sprite.
+        int first = (int)vertices.size();
+        vertices.push_back({ { x1, y1 }, color, { u1, v1 } });
+        vertices.push_back({ { x2, y1 }, color, { u2, v1 } });
+        vertices.push_back({ { x2, y2 }, color, { u2, v2 } });
+        vertices.push_back({ { x1, y2 }, color, { u1, v2 } });
+
+        indices.push_back(first);
+        indices.push_back(first + 1);
+        indices.push_back(first + 2);
+        indices.push_back(first);
+        indices.push_back(first + 2);
+        indices.push_back(first + 3);
+    };
+
+    // Draws everything we've collected so far.
+    void Flush()
+    {
+        if (vertices.empty()) return;
+
+        SDL_RenderGeometry(renderer, texture, vertices.data(), (int)vertices.size(), indices.data(), (int)indices.size());
+        drawCalls++;
+
+        vertices.clear();
+        indices.clear();
+    };
+
+    // Draws anything left over. Returns the amount of draw calls this batch made.
+    int End()
+    {
+        Flush();
+        return drawCalls;
+    };
+
+private:
+    SDL_Renderer* renderer = nullptr;
+    SDL_Texture* texture = nullptr;
+    float textureWidth = 1;
+    float textureHeight = 1;
+    int drawCalls = 0;
+
+    // These are kept around between batches so we're not constantly reallocating them.
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+};
+#endif // !SPRITEBATCH_H
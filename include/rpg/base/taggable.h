@@ -4,44 +4,149 @@
 #include <string>
 #include <algorithm>
 #include <vector>
+#include <bitset>
+#include <unordered_map>
 
-class Taggable
+// Every tag is given a small number when it's first used, so checking for a tag
+// doesn't need to compare strings.
+typedef unsigned int TagID;
+
+// Tags used by the engine itself. These are always registered first, so they always
+// have the same ID and always fit in a Taggable's bitset.
+enum BuiltInTag : TagID
+{
+    Tag_Collision,
+
+    Tag_Renderable,
+    Tag_NotRendering,
+    Tag_DontFollowCamera,
+
+    Tag_Movable,
+    Tag_DontMove,
+
+    Tag_Entity,
+    Tag_PlayerEntity,
+    Tag_Character,
+    Tag_Light,
+    Tag_Global,
+
+    Tag_GUIElement,
+    Tag_ChildGUIElement,
+
+    Tag_BuiltInCount
+};
+
+// How many tags a Taggable can hold in its bitset. Tags registered after this are
+// stored in a (much slower) list instead.
+#define MAX_BITSET_TAGS 64
+
+// Holds the name of every tag we know about. Scripts and Tiled data still give us
+// tags as strings, and this is where they get turned into IDs.
+class TagRegistry
 {
 public:
-    bool HasTag(std::string tag)
+    // The main instance of the registry that is globally accessable.
+    static TagRegistry* instance()
     {
-        auto iter = std::find(this->tags.begin(), this->tags.end(), tag);
-        return !(iter == this->tags.end());
+        static TagRegistry instance;
+        return &instance;
     };
 
-    void AddTag(std::string tag)
+    // Grabs the ID of a tag, registering it if we haven't seen it before.
+    TagID Intern(const std::string& tag)
     {
-        this->tags.push_back(tag);
-        return;
+        auto iter = ids.find(tag);
+        if (iter != ids.end()) return iter->second;
+
+        TagID id = (TagID)names.size();
+        ids.insert({ tag, id });
+        names.push_back(tag);
+        return id;
     };
-    
-    void RemoveTag(std::string tag)
+
+    // Grabs the ID of a tag without registering it. Returns false if nothing has used this tag yet.
+    bool Find(const std::string& tag, TagID& id)
     {
-        tags.erase(std::remove(this->tags.begin(), this->tags.end(), tag));
-        return;
+        auto iter = ids.find(tag);
+        if (iter == ids.end()) return false;
+
+        id = iter->second;
+        return true;
     };
 
+    // Grabs the name of a tag.
+    const std::string& GetName(TagID id) { return names[id]; };
+
 private:
-    std::vector<std::string> tags;
+    TagRegistry()
+    {
+        // These need to be in the same order as BuiltInTag.
+        const char* builtIn[Tag_BuiltInCount] =
+        {
+            "Collision",
+            "Renderable", "NotRendering", "DontFollowCamera",
+            "Movable", "DontMove",
+            "Entity", "PlayerEntity", "Character", "Light", "Global",
+            "GUIElement", "ChildToGUIElement",
+        };
+
+        for (auto& tag : builtIn) Intern(tag);
+    };
+
+    std::unordered_map<std::string, TagID> ids;
+    std::vector<std::string> names;
 };
 
-#define Tag_Collision           std::string("Collision")
+class Taggable
+{
+public:
+    bool HasTag(TagID tag)
+    {
+        if (tag < MAX_BITSET_TAGS) return tagBits.test(tag);
+        return std::find(this->extraTags.begin(), this->extraTags.end(), tag) != this->extraTags.end();
+    };
 
-#define Tag_Renderable          std::string("Renderable")
-#define Tag_NotRendering        std::string("NotRendering")
-#define Tag_DontFollowCamera    std::string("DontFollowCamera")
+    void AddTag(TagID tag)
+    {
+        if (tag < MAX_BITSET_TAGS)
+        {
+            tagBits.set(tag);
+            return;
+        }
 
-#define Tag_Movable             std::string("Movable")
+        if (!HasTag(tag)) this->extraTags.push_back(tag);
+    };
 
-#define Tag_Entity              std::string("Entity")
-#define Tag_PlayerEntity        std::string("PlayerEntity")
-#define Tag_Global              std::string("Global")
+    void RemoveTag(TagID tag)
+    {
+        if (tag < MAX_BITSET_TAGS)
+        {
+            tagBits.reset(tag);
+            return;
+        }
+
+        extraTags.erase(std::remove(this->extraTags.begin(), this->extraTags.end(), tag), this->extraTags.end());
+    };
 
-#define Tag_GUIElement          std::string("GUIElement")
-#define Tag_ChildGUIElement     std::string("ChildToGUIElement")
-#endif
\ No newline at end of file
+    // String versions for scripts and Tiled data.
+    bool HasTag(const std::string& tag)
+    {
+        // If nothing has ever used this tag, we can't have it.
+        TagID id;
+        if (!TagRegistry::instance()->Find(tag, id)) return false;
+        return HasTag(id);
+    };
+
+    void AddTag(const std::string& tag) { AddTag(TagRegistry::instance()->Intern(tag)); };
+
+    void RemoveTag(const std::string& tag)
+    {
+        TagID id;
+        if (TagRegistry::instance()->Find(tag, id)) RemoveTag(id);
+    };
+
+private:
+    std::bitset<MAX_BITSET_TAGS> tagBits;
+    std::vector<TagID> extraTags;
+};
+#endif
@@ -0,0 +1,138 @@
+#pragma once
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A handful of threads that sit around waiting for work, so we don't have to start up new
+// threads every time we want to split something up. Jobs are numbered, and each job is
+// handed to whichever thread is free next.
+class WorkerPool
+{
+public:
+    // The main instance of the pool that is globally accessable. It has one thread for
+    // every core, counting the thread that calls Run().
+    static WorkerPool* instance()
+    {
+        static WorkerPool instance;
+        return &instance;
+    };
+
+    // How many threads can work on jobs at once, including the thread that calls Run().
+    int GetThreadCount() { return (int)workers.size() + 1; };
+
+    // Runs job(0) to job(count - 1) across all of our threads, and waits for all of them to
+    // finish. Jobs can run in any order, so they shouldn't write to anything another job uses.
+    // This should only be called from the main thread, and never from inside a job.
+    void Run(int count, const std::function<void(int)>& job)
+    {
+        if (count <= 0) return;
+
+        // Not worth waking anyone up for a single job.
+        if (count == 1 || workers.empty())
+        {
+            for (int i = 0; i < count; i++) job(i);
+            return;
+        }
+
+        // Wait for any threads still finishing up the last lot of jobs before handing out new ones.
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this] { return activeWorkers == 0; });
+
+        currentJob = &job;
+        jobCount = count;
+        nextJob = 0;
+        generation++;
+
+        lock.unlock();
+        wake.notify_all();
+
+        // We help out too rather than just waiting around.
+        DoJobs();
+
+        // Every job has been taken, but some of them might still be running.
+        lock.lock();
+        idle.wait(lock, [this] { return activeWorkers == 0; });
+        currentJob = nullptr;
+    };
+
+private:
+    WorkerPool()
+    {
+        unsigned int threads = std::thread::hardware_concurrency();
+        for (unsigned int i = 1; i < threads; i++)
+        {
+            workers.emplace_back([this] { WorkerLoop(); });
+        }
+    };
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+
+        wake.notify_all();
+        for (auto& worker : workers) worker.join();
+    };
+
+    // Sleeps until there are jobs to do, and then does them.
+    void WorkerLoop()
+    {
+        int seenGeneration = 0;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seenGeneration; });
+                if (stopping) return;
+
+                seenGeneration = generation;
+                activeWorkers++;
+            }
+
+            DoJobs();
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                activeWorkers--;
+            }
+            idle.notify_all();
+        }
+    };
+
+    // Keeps grabbing the next job until there aren't any left.
+    void DoJobs()
+    {
+        while (true)
+        {
+            int index = nextJob.fetch_add(1);
+            if (index >= jobCount) return;
+            (*currentJob)(index);
+        }
+    };
+
+    std::vector<std::thread> workers;
+
+    // Protects everything below that isn't atomic.
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+
+    // The jobs we're currently running. These only change while no workers are active.
+    const std::function<void(int)>* currentJob = nullptr;
+    int jobCount = 0;
+    std::atomic<int> nextJob = 0;
+
+    // Goes up every time Run() hands out new jobs, so workers know there's something to do.
+    int generation = 0;
+    int activeWorkers = 0;
+    bool stopping = false;
+};
+#endif // !WORKERPOOL_H
@@ -5,6 +5,22 @@
 #include "SDL/SDL.h"
 #include <memory>
 
+// How fast our character moves, in pixels per millisecond. This is 5 pixels a frame at 60fps.
+#define CHARACTER_SPEED 0.3f
+
+// The longest frame we'll move for, in milliseconds.
+#define CHARACTER_MAX_DELTA 100.0f
+
+// How many times we'll slide along something we've hit in a single frame.
+#define CHARACTER_MAX_SLIDES 3
+
+// How far (in pixels) we can be inside of something and still count as touching it. Floating
+// point errors can leave us this far inside of a wall after we've been snapped to its edge.
+#define CHARACTER_COLLISION_EPSILON 0.01f
+
+// Checks if two rectangles overlap. This is what all of our collision uses.
+bool SDL_FIntersectRect(SDL_FRect a, SDL_FRect b);
+
 class Character : public Entity
 {
 public:
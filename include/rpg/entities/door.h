@@ -9,6 +9,14 @@
 
 using json = nlohmann::json;
 
+// The properties a door can be given in Tiled.
+struct DoorProperties
+{
+	bool enabled = true;			// enabled
+	std::string landmarkName;		// landmark_entity
+	std::string levelDestination;	// level
+};
+
 // The class that represents an NPC.
 class DoorEntity : public Entity
 {
@@ -16,14 +24,13 @@ public:
 	DoorEntity() {};
 	~DoorEntity() {};
 
-	bool enabled;
-	std::string landmarkName;
-	std::string levelDestination;
+	// Decoded from Tiled when the level is loaded.
+	DoorProperties properties;
 	
-	bool alreadyFaded;
+	bool alreadyFaded = false;
 
-	// Update logic.
-	void Update(float dT);
+	// Doors don't update, they just wait for the character to walk into their trigger.
 	void OnEntitySpawned();
+	void OnTriggerEnter(Entity* other);
 };
 #endif
\ No newline at end of file
@@ -6,33 +6,45 @@
 #include "SDL/SDL.h"
 #include <cmath>
 
+// The properties a light can be given in Tiled.
+struct LightProperties
+{
+    int colorR = 255;       // color_r
+    int colorG = 255;       // color_g
+    int colorB = 255;       // color_b
+    int intensity = 0;      // intensity
+    bool shadows = false;   // shadows
+};
+
 class Light : public Entity
 {
 public:
     // Initalizer.
     Light()
     {
-        this->AddTag("Light");
+        this->AddTag(Tag_Light);
     };
     ~Light() {};
 
     void OnEntityCreated()
     {
-        // Loop through the doors properties and set stuff acoordingly.
-        for (auto& element : tiledProperties)
-        {
-            // Grab the name of this element.
-            auto name = element["name"].get < std::string >();
-
-            // Set our properties.
-            if (name == "color_r") this->colorModifier.r = element["value"].get< int >();
-            if (name == "color_g") this->colorModifier.g = element["value"].get< int >();
-            if (name == "color_b") this->colorModifier.b = element["value"].get< int >();
-            if (name == "intensity") this->intensity = element["value"].get< int >();
-        }
+        // Our properties have already been decoded, so just copy them over.
+        this->colorModifier = { (Uint8)properties.colorR, (Uint8)properties.colorG, (Uint8)properties.colorB, 255 };
+        this->intensity = properties.intensity;
+        this->shadows = properties.shadows;
     }
 
+    // Decoded from Tiled when the level is loaded.
+    LightProperties properties;
+
+    // How far away (in pixels) this light can reach. Nothing past this is lit by us.
+    float GetInfluenceRadius();
+
     int intensity;
+
+    // Whether collision blocks this light. Shadows are rebuilt whenever the light moves, so
+    // they cost a lot more than a normal light.
+    bool shadows = false;
 };
 
 inline float CalculateDistance(float x, float y)
@@ -43,6 +55,18 @@ inline float CalculateDistance(float x, float y)
 #define start1 0
 #define end1 255
 
+// The furthest distance (in pixels) a light can reach before CalculateLightingFromDistance
+// starts returning black. This is slightly bigger than it needs to be just to be safe.
+inline float CalculateLightRadius(int lightIntensity)
+{
+    return (float)((80 * 1 - (lightIntensity / 100)) * ((M_PI * lightIntensity) / 100) + 1);
+}
+
+inline float Light::GetInfluenceRadius()
+{
+    return CalculateLightRadius(intensity);
+}
+
 inline SDL_Color CalculateLightingFromDistance(float dist, SDL_Color lightColor, int lightIntensity)
 {
     int r = 0, g = 0, b = 0;
@@ -63,53 +87,46 @@ inline SDL_Color CalculateLightingFromDistance(float dist, SDL_Color lightColor,
     return { (Uint8)r, (Uint8)g, (Uint8)b };
 }
 
-inline SDL_Color CalculateLightingFromEntityToTile(Entity* entity, Tile* tile, SDL_Color lightColor, int lightIntensity)
+// Every light falls off based on the whole number of pixels between two positions, after
+// those positions have been rounded down. Anything that caches lighting relies on this.
+inline int CalculateLightDistance(float x, float y)
 {
-    // Calculate the "lighting" for this tile by checking it's position related to the player.
-    float x = floor(tile->levelX - entity->levelX);
-    float y = floor(tile->levelY - entity->levelY);
-    float dist = -ceil(sqrt(pow(x, 2) + pow(y, 2)));
-
-    dist = dist / ((M_PI * lightIntensity) / 100);
-
-    return CalculateLightingFromDistance(dist, lightColor, lightIntensity);
+    double floorX = floor(x);
+    double floorY = floor(y);
+    return (int)ceil(sqrt(floorX * floorX + floorY * floorY));
 }
 
-inline SDL_Color CalculateLightingFromEntityToEntity(Entity* entityA, Entity* entityB, SDL_Color lightColor, int lightIntensity)
+inline SDL_Color CalculateLightingFromLightDistance(int distance, SDL_Color lightColor, int lightIntensity)
 {
-    // Calculate the "lighting" for this tile by checking it's position related to the player.
-    float x = floor(entityA->levelX - entityB->levelX);
-    float y = floor(entityA->levelY - entityB->levelY);
-    float dist = -ceil(sqrt(pow(x, 2) + pow(y, 2)));
-
+    float dist = -(float)distance;
     dist = dist / ((M_PI * lightIntensity) / 100);
 
     return CalculateLightingFromDistance(dist, lightColor, lightIntensity);
 }
 
-
-inline SDL_Color CalculateLightingFromPositionToTile(float xPos, float yPos, Tile* tile, SDL_Color lightColor, int lightIntensity)
+inline SDL_Color CalculateLightingFromEntityToTile(Entity* entity, float tileX, float tileY, SDL_Color lightColor, int lightIntensity)
 {
     // Calculate the "lighting" for this tile by checking it's position related to the player.
-    float x = floor(tile->levelX - xPos);
-    float y = floor(tile->levelY - yPos);
-    float dist = -ceil(sqrt(pow(x, 2) + pow(y, 2)));
+    int distance = CalculateLightDistance(tileX - entity->levelX, tileY - entity->levelY);
+    return CalculateLightingFromLightDistance(distance, lightColor, lightIntensity);
+}
 
-    dist = dist / ((M_PI * lightIntensity) / 100);
+inline SDL_Color CalculateLightingFromEntityToEntity(Entity* entityA, Entity* entityB, SDL_Color lightColor, int lightIntensity)
+{
+    int distance = CalculateLightDistance(entityA->levelX - entityB->levelX, entityA->levelY - entityB->levelY);
+    return CalculateLightingFromLightDistance(distance, lightColor, lightIntensity);
+}
 
-    return CalculateLightingFromDistance(dist, lightColor, lightIntensity);
+inline SDL_Color CalculateLightingFromPositionToTile(float xPos, float yPos, float tileX, float tileY, SDL_Color lightColor, int lightIntensity)
+{
+    int distance = CalculateLightDistance(tileX - xPos, tileY - yPos);
+    return CalculateLightingFromLightDistance(distance, lightColor, lightIntensity);
 }
 
 inline SDL_Color CalculateLightingFromPositionToEntity(float xPos, float yPos, Entity* entity, SDL_Color lightColor, int lightIntensity)
 {
-    // Calculate the "lighting" for this tile by checking it's position related to the player.
-    float x = floor(entity->levelX - xPos);
-    float y = floor(entity->levelY - yPos);
-    float dist = -ceil(sqrt(pow(x, 2) + pow(y, 2)));
-
-    dist = dist / ((M_PI * lightIntensity) / 100);
-
-    return CalculateLightingFromDistance(dist, lightColor, lightIntensity);
+    int distance = CalculateLightDistance(entity->levelX - xPos, entity->levelY - yPos);
+    return CalculateLightingFromLightDistance(distance, lightColor, lightIntensity);
 }
 
 #endif
\ No newline at end of file
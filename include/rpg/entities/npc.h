@@ -10,6 +10,15 @@
 
 using json = nlohmann::json;
 
+// The properties an NPC can be given in Tiled.
+struct NPCProperties
+{
+	std::string name;			// npc_name
+	std::string sprite;			// npc_sprite
+	float useDistance = 0.0f;	// npc_use_dist
+	std::string actionFile;		// npc_action_file
+};
+
 // The class that represents an NPC.
 class NPCEntity : public Entity
 {
@@ -26,6 +35,9 @@ public:
 
 	void OnEntitySpawned();
 
+	// Decoded from Tiled when the level is loaded.
+	NPCProperties properties;
+
 	// The name of this NPC.
 	std::string npcName;
 
@@ -4,6 +4,7 @@
 #include "rpg/base/taggable.h"
 #include "rpg/base/renderable.h"
 #include "rpg/base/inputtable.h"
+#include "rpg/entityhandle.h"
 #include "json/json.hpp"
 
 #include <string>
@@ -15,33 +16,46 @@ class Entity
 {
 public:
     Entity();
-    virtual ~Entity() {};
+    virtual ~Entity() { EntityRegistry::instance()->Unregister(handle); };
     std::string classname;
     std::string targetname;
 
+    // A handle to ourselves. Hold onto this instead of a pointer to us if we might be destroyed first.
+    EntityHandle handle;
+
     virtual void OnEntityCreated() {};
     virtual void OnEntitySpawned() {};
     virtual void OnEntityDestroyed() {};
 
-    // Updating and logic.
+    // Updating and logic. Update() is only called for entities with hasScript set.
     virtual void Update(float deltaTime) {};
+    bool hasScript = false;
     float nextUpdate;   // If there is to be a delay in processing the logic in the
                         // Think function, have an already defined variable for it.
 
     // Performing a "use" action.
-    Entity*         useActivator = nullptr; // The Entity that uses ourselves.
+    EntityHandle    useActivator; // The Entity that uses ourselves.
     bool            isCurrentlyUsed = false;
     float           useDistance = 0.0f; // Distance the Character needs to be away to trigger OnUse().
     virtual void    OnUse(Entity* activator) {};
     virtual void    OnUseFinished(Entity* activator) {};
 
+    // Where our components are stored in our level's ComponentStore.
+    int             entityID = -1;
+
+    // The area we were last put in our level's entity index with, so we know when we've moved.
+    SDL_FRect       indexedArea = { 0, 0, 0, 0 };
+    bool            isIndexed = false;
+
+    // Trigger volumes. Owners of a trigger are told whenever another entity starts or stops
+    // touching it. touchingTriggers holds the triggers we're inside of, sorted by index.
+    std::vector<int> touchingTriggers;
+    virtual void    OnTriggerEnter(Entity* other) {};
+    virtual void    OnTriggerExit(Entity* other) {};
+
     // Color modifier for this entity - This is primarily used for lighting.
     SDL_Color colorModifier;
 
-    // Custom properties from Tiled.
-    using json = nlohmann::json;
-    std::vector<json> tiledProperties;
-
     // Check for collision between another entity.
     virtual bool CheckCollision(Entity *ent)
     {
@@ -0,0 +1,137 @@
+#pragma once
+#ifndef HEADER_H_ENTITYFACTORY
+#define HEADER_H_ENTITYFACTORY
+
+#include "rpg/entity.h"
+#include "json/json.hpp"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+
+// Every entity type is given a small number when it's registered, same as tags.
+typedef unsigned int EntityTypeID;
+
+// Creates a new entity of a type.
+typedef std::function<std::unique_ptr<Entity>()> EntityCreator;
+
+// Reads the custom properties Tiled gives an object (the object's "properties" array) into the entity
+// that was created for it. The JSON is thrown away once the level has loaded, so anything the entity
+// needs has to be copied out here.
+typedef std::function<void(Entity*, const nlohmann::json&)> EntityPropertyParser;
+
+// Describes the custom properties an entity type can be given in Tiled, and which member of a plain
+// struct each one is decoded into. Properties that aren't in the schema are ignored.
+template < typename Properties >
+class PropertySchema
+{
+public:
+    // Adds a property, decoded as whatever type the member is.
+    template < typename Value >
+    PropertySchema& Add(const std::string& name, Value Properties::* member)
+    {
+        fields[name] = [member](Properties& properties, const nlohmann::json& value) { properties.*member = value.get<Value>(); };
+        return *this;
+    };
+
+    // Decodes an object's properties into our struct. Each property is a single hash lookup.
+    void Decode(const nlohmann::json& properties, Properties& out) const
+    {
+        for (auto& element : properties)
+        {
+            auto field = fields.find(element["name"].get_ref<const std::string&>());
+            if (field != fields.end()) field->second(out, element["value"]);
+        }
+    };
+
+    // Makes a parser for the factory that decodes straight into a member of an entity.
+    template < typename T >
+    EntityPropertyParser Parser(Properties T::* member) const
+    {
+        PropertySchema schema = *this;
+        return [schema, member](Entity* entity, const nlohmann::json& properties)
+        {
+            schema.Decode(properties, static_cast<T*>(entity)->*member);
+        };
+    };
+
+private:
+    std::unordered_map<std::string, std::function<void(Properties&, const nlohmann::json&)>> fields;
+};
+
+// Everything we need to know to create an entity from a Tiled object.
+struct EntityType
+{
+    EntityTypeID id = 0;
+    std::string classname;
+
+    EntityCreator create;
+    EntityPropertyParser parseProperties;
+
+    // Only one entity of this type can be in a level at a time. Any more are ignored.
+    bool unique = false;
+};
+
+// Creates entities from the type Tiled gives them. Entity classes register themselves here
+// (see EntityRegistration), so adding a new type of entity doesn't need any changes to the level loader.
+class EntityFactory
+{
+public:
+    // The main instance of the factory that is globally accessable.
+    static EntityFactory* instance()
+    {
+        static EntityFactory instance;
+        return &instance;
+    };
+
+    // Adds an entity type. Registering the same classname twice replaces the first one.
+    EntityTypeID Register(const std::string& classname, EntityCreator create, EntityPropertyParser parseProperties = nullptr, bool unique = false)
+    {
+        auto iter = ids.find(classname);
+        EntityTypeID id = iter != ids.end() ? iter->second : (EntityTypeID)types.size();
+        if (iter == ids.end())
+        {
+            ids.insert({ classname, id });
+            types.emplace_back();
+        }
+
+        EntityType& type = types[id];
+        type.id = id;
+        type.classname = classname;
+        type.create = create;
+        type.parseProperties = parseProperties;
+        type.unique = unique;
+        return id;
+    };
+
+    // Grabs an entity type by its classname, or nullptr if nothing has registered it.
+    const EntityType* Find(const std::string& classname) const
+    {
+        auto iter = ids.find(classname);
+        return iter != ids.end() ? &types[iter->second] : nullptr;
+    };
+
+    const EntityType* Get(EntityTypeID id) const { return id < types.size() ? &types[id] : nullptr; };
+
+private:
+    std::unordered_map<std::string, EntityTypeID> ids;
+    std::vector<EntityType> types;
+};
+
+// Registers an entity class with the factory before the game starts. Put one of these next to
+// the class in its source file, e.g:
+//      static EntityRegistration<DoorEntity> doorRegistration("door");
+template < typename T >
+struct EntityRegistration
+{
+    EntityRegistration(const std::string& classname, EntityPropertyParser parseProperties = nullptr, bool unique = false)
+    {
+        id = EntityFactory::instance()->Register(classname, []() { return std::unique_ptr<Entity>(new T()); }, parseProperties, unique);
+    };
+
+    EntityTypeID id;
+};
+
+#endif
@@ -0,0 +1,101 @@
+#pragma once
+#ifndef HEADER_H_ENTITYHANDLE
+#define HEADER_H_ENTITYHANDLE
+
+#include "SDL/SDL.h"
+#include <vector>
+
+class Entity;
+
+// A safe reference to an entity. Once the entity is destroyed, its handles resolve to nullptr
+// instead of pointing at freed memory, so they can be held onto for as long as we like.
+// Handles are an index into the EntityRegistry plus the generation of that slot when the
+// handle was made. Slots are reused, but their generation goes up every time, so an old
+// handle can never resolve to a new entity.
+struct EntityHandle
+{
+    Uint32 index = 0;
+    Uint32 generation = 0; // Generation 0 is never used, so a default handle is always invalid.
+
+    bool operator==(const EntityHandle& other) const { return index == other.index && generation == other.generation; };
+    bool operator!=(const EntityHandle& other) const { return !(*this == other); };
+
+    // Grabs the entity this handle points to, or nullptr if it has been destroyed.
+    Entity* Get() const;
+
+    template < typename T >
+    T* GetAs() const { return dynamic_cast<T*>(Get()); };
+
+    bool IsValid() const { return Get() != nullptr; };
+};
+
+// Hands out a handle to every entity when it's created, and invalidates it when it's destroyed.
+class EntityRegistry
+{
+public:
+    // The main instance of the registry that is globally accessable.
+    static EntityRegistry* instance()
+    {
+        static EntityRegistry instance;
+        return &instance;
+    };
+
+    EntityHandle Register(Entity* entity)
+    {
+        EntityHandle handle;
+
+        // Reuse an old slot if we have one.
+        if (!freeSlots.empty())
+        {
+            handle.index = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        else
+        {
+            handle.index = (Uint32)slots.size();
+            slots.emplace_back();
+        }
+
+        slots[handle.index].entity = entity;
+        handle.generation = slots[handle.index].generation;
+        return handle;
+    };
+
+    void Unregister(EntityHandle handle)
+    {
+        if (Resolve(handle) == nullptr) return;
+
+        // Bumping our generation invalidates every handle to this slot.
+        Slot& slot = slots[handle.index];
+        slot.entity = nullptr;
+        slot.generation++;
+        if (slot.generation == 0) slot.generation = 1;
+
+        freeSlots.push_back(handle.index);
+    };
+
+    Entity* Resolve(EntityHandle handle)
+    {
+        if (handle.index >= slots.size()) return nullptr;
+
+        const Slot& slot = slots[handle.index];
+        return slot.generation == handle.generation ? slot.entity : nullptr;
+    };
+
+private:
+    struct Slot
+    {
+        Entity* entity = nullptr;
+        Uint32 generation = 1;
+    };
+
+    std::vector<Slot> slots;
+    std::vector<Uint32> freeSlots;
+};
+
+inline Entity* EntityHandle::Get() const
+{
+    return EntityRegistry::instance()->Resolve(*this);
+}
+
+#endif
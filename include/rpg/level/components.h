@@ -0,0 +1,83 @@
+#pragma once
+#ifndef COMPONENTS_H
+#define COMPONENTS_H
+
+#include "SDL/SDL.h"
+#include "rpg/level/tile.h"
+
+#include <array>
+#include <vector>
+
+class Entity;
+
+// The index of an entity in a ComponentStore.
+typedef int EntityID;
+
+// Where an entity is in level space. This is the top left of the entity.
+struct PositionComponent
+{
+	float x = 0;
+	float y = 0;
+};
+
+// How big an entity is when it's drawn, and whether it's drawn at all.
+struct SpriteComponent
+{
+	float w = 0;
+	float h = 0;
+	bool visible = true;
+};
+
+// The area an entity takes up in level space, for entities that can collide with things.
+// Only entities with a collider set off triggers.
+struct ColliderComponent
+{
+	EntityID owner = -1;
+	SDL_FRect area = { 0, 0, 0, 0 };
+};
+
+// An entity with logic that needs to run every frame.
+struct ScriptComponent
+{
+	EntityID owner = -1;
+	Entity* entity = nullptr;
+};
+
+// Keeps the parts of our entities that are used every frame in tightly packed arrays, so drawing
+// and updating a level walks straight through memory instead of jumping between entities. Entities
+// themselves still hold everything else, and are only touched when they're drawn or updated.
+//
+// Every entity has a position and a sprite, stored at its ID. Colliders and scripts are only
+// given to entities that need them, and are packed together with the ID of their owner.
+class ComponentStore
+{
+public:
+	// Adds an entity to a layer, giving it whatever components it needs.
+	EntityID Add(Entity* entity, int layer);
+
+	// Copies an entity's position, size and tags into its components. Returns false if the
+	// entity hasn't moved or changed size.
+	bool Sync(EntityID id);
+
+	// Grabs an entity's collider, or nullptr if it doesn't have one.
+	ColliderComponent* GetCollider(EntityID id);
+
+	// Removes every entity.
+	void Clear();
+
+	// Every entity, by ID.
+	std::vector<Entity*> entities;
+
+	std::vector<PositionComponent> positions;
+	std::vector<SpriteComponent> sprites;
+	std::vector<ColliderComponent> colliders;
+	std::vector<ScriptComponent> scripts;
+
+	// The index into colliders for each entity, or -1 if it doesn't have one.
+	std::vector<int> colliderIndices;
+
+	// The entities on each layer, in the order they're drawn.
+	std::array<std::vector<EntityID>, MAX_TILE_LAYERS> layers;
+};
+
+#endif
@@ -4,20 +4,32 @@
 
 #include <vector>
 #include <array>
+#include <unordered_map>
 
 #include "SDL/SDL.h"
 
 #include "rpg/entity.h"
 #include "rpg/entities/character.h"
 #include "rpg/level/tile.h"
+#include "rpg/level/tilechunk.h"
+#include "rpg/level/spatialhash.h"
+#include "rpg/level/lighting.h"
+#include "rpg/level/components.h"
 #include "rpg/base/renderable.h"
 #include "rpg/base/taggable.h"
 #include <memory>
 
+// Set this to 1 to check that merging our collision rectangles didn't change anywhere that's
+// blocked (in debug mode). This copies every rectangle and compares both sets as levels load.
+#ifndef CHECK_COLLISION_MERGE
+#define CHECK_COLLISION_MERGE 0
+#endif
+
+// A rectangle that entities can't move through. These are in level space and never
+// change once the level has loaded, so they can be indexed and never touched again.
 struct CollisionRect
 {
-	SDL_FRect collisionRect;
-	float levelX, levelY;
+	SDL_FRect rect;
 };
 
 struct LevelTransitionData
@@ -27,6 +39,14 @@ struct LevelTransitionData
 	std::string new_level;
 };
 
+// An area in level space that tells its owner whenever an entity starts or stops touching it.
+// Triggers are only checked when an entity moves, so triggers themselves don't cost anything.
+struct TriggerVolume
+{
+	EntityHandle owner;
+	SDL_FRect area = { 0, 0, 0, 0 };
+};
+
 class Level
 {
 public:
@@ -39,16 +59,113 @@ public:
 	// Grab the character that we control.
 	Character* GetCharacter();
 
+	// The character we control, picked up when it's added to the level.
+	EntityHandle lCharacter;
+
+	// Every entity, by targetname and by classname. Entities are added as they're created and
+	// dropped when the level is freed. Handles of destroyed entities are skipped when we look things up.
+	std::unordered_map < std::string, std::vector < EntityHandle > > lTargetnames;
+	std::unordered_map < std::string, std::vector < EntityHandle > > lClassnames;
+
+	// Adds an entity to our targetname and classname lookups.
+	void RegisterEntity(Entity* entity);
+
+	// Grabs the first entity with this targetname (and classname, if there is one), or nullptr if there isn't one.
+	Entity* FindEntity(const std::string& targetname, const std::string& classname = "");
+
+	// Grabs every entity with this targetname or classname.
+	void FindEntitiesByName(const std::string& targetname, std::vector<Entity*>& out);
+	void FindEntitiesByClass(const std::string& classname, std::vector<Entity*>& out);
+
 	// A list of this levels local entities. This list gets completely scrapped
 	// when this level is unloaded.
 	std::array < std::vector < std::unique_ptr<Entity> >, MAX_TILE_LAYERS >  lEntities;
 
-	// We support up to 16 layers of tiles at one time. Each layer consists of a vector of Tile pointers.
-	std::array < std::vector < std::unique_ptr<Tile> >, MAX_TILE_LAYERS > lTiles;
+	// We support up to 16 layers of tiles at one time. Each layer is a grid of tile IDs.
+	std::array < TileLayer, MAX_TILE_LAYERS > lTiles;
+
+	// Each tile layer pre-rendered into chunks. These are built once the tiles are created.
+	std::array < TileChunkCache, MAX_TILE_LAYERS > lTileChunks;
+
+	// Marks any chunks touching this area (in level space) to be rendered again. This needs
+	// to be called whenever a tile changes.
+	void InvalidateTiles(SDL_FRect area);
+	void InvalidateAllTiles();
+
+	// Throws away every chunk texture after the renderer has lost them. They're recreated when they're next drawn.
+	void ReleaseTileTextures();
+
+	// Grabs the baked light of the tile under a position in level space. Returns false (and black)
+	// if there aren't any tiles there.
+	bool SampleTileLight(float x, float y, SDL_Color& light);
+
+	// Every light that has been baked into our tiles.
+	std::vector < BakedLight > lLights;
+
+	// Adds, removes or relights a light. Only the tiles the light reaches (both before and
+	// after it changed) are relit, so these are cheap enough to call every frame.
+	void AddLight(Light* light);
+	void RemoveLight(Light* light);
+	void UpdateLight(Light* light);
+
+	// Shadowed lights that have moved and are waiting for their shadow to be rebuilt.
+	std::vector < Light* > lPendingShadows;
+
+	// Rebuilds the shadows of lights that have moved, until we've spent this many milliseconds.
+	void ProcessPendingShadows(double budget);
+
+	// The parts of our entities that we use every frame. lEntities still owns every entity.
+	ComponentStore lComponents;
+
+	// Copies an entity's position into its components, and updates our index and triggers if it has
+	// moved. Bookkeeping that doesn't depend on position (like use distances) is updated either way.
+	// Entities with scripts are synced every frame, anything else that moves an entity needs to call this.
+	void SyncEntity(Entity* entity);
+
+	// Every entity, split up by where it is in the level. Entities are moved around in here
+	// after they update.
+	SpatialHash < Entity* > lEntityHash;
+
+	// The furthest any entity in the level can be used from.
+	float lMaxUseDistance = 0;
+
+	// Adds an entity to our index, or moves it if it has moved since we last indexed it.
+	// Returns false if the entity hasn't moved.
+	bool IndexEntity(Entity* entity);
+
+	// Keeps lMaxUseDistance up to date with an entity's use distance. This doesn't depend on where the
+	// entity is, so it isn't tied to our index. Entities usually set their use distance when they spawn.
+	void UpdateUseDistance(Entity* entity);
+
+	// Makes sure every entity that can be used is found from inside its use distance. This is only
+	// checked in debug mode. Returns false (and prints which) if any can't be.
+	bool CheckUseDistances();
+
+	// Grabs the entities that could be touching an area in level space.
+	void QueryEntities(SDL_FRect area, std::vector<Entity*>& out);
+
+	// Grabs the entities whose center is within a distance of a point in level space.
+	void QueryEntitiesInRadius(float x, float y, float radius, std::vector<Entity*>& out);
+
+	// Every trigger volume in the level, and the same split up by where they are.
+	std::vector < TriggerVolume > lTriggers;
+	SpatialHash < int > lTriggerHash;
+
+	// Adds a trigger volume covering an area in level space. Returns the index of the trigger.
+	int AddTrigger(Entity* owner, SDL_FRect area);
+
+	// Works out which triggers an entity has entered or left since it last moved, and tells their owners.
+	void UpdateTriggers(Entity* entity);
 
 	// All of the rectangles that we can collide with.
 	std::vector < CollisionRect > lCollisionR;
 
+	// Indexes into lCollisionR, split up by where they are in the level.
+	SpatialHash < int > lCollisionHash;
+
+	// Grabs the collision rectangles that could be touching an area in level space.
+	void QueryCollision(SDL_FRect area, std::vector<CollisionRect*>& out);
+
 	using json = nlohmann::json;
 
 	// Load the level with it's tile and entity data.
@@ -56,6 +173,15 @@ public:
 	bool CreateTiles(json levelData);
 	bool CreateEntities(json levelData);
 	bool CreateCollision(json levelData);
+	bool CreateLighting(std::string cachePath);
+	Uint64 HashLighting();
+	void MergeCollision();
+	void BuildLightTotals(TileLayer& tileLayer);
+	void RelightArea(SDL_FRect area);
+	void ReplaceLight(BakedLight& baked, const BakedLight& updated);
+	void BuildShadow(BakedLight& light);
+	void BuildMissingShadows();
+	void BuildCollisionHash();
 
 	void LevelUpdate(float dT);
 
@@ -0,0 +1,73 @@
+#pragma once
+#ifndef LIGHTCACHE_H
+#define LIGHTCACHE_H
+
+#include "SDL/SDL.h"
+#include "rpg/level/tile.h"
+
+#include <string>
+
+// Bump this whenever the way we light tiles changes, so old caches are thrown away.
+#define LIGHT_CACHE_VERSION 1
+
+// Builds up a 64-bit FNV-1a hash of everything that affects our lighting. If the hash of a level
+// matches the hash in its cache, we can use the cached lighting instead of baking it again.
+class ContentHash
+{
+public:
+	void Add(const void* data, size_t size)
+	{
+		const Uint8* bytes = (const Uint8*)data;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ULL;
+		}
+	};
+
+	template < typename T >
+	void Add(const T& value) { Add(&value, sizeof(T)); };
+
+	Uint64 Get() const { return hash; };
+
+private:
+	Uint64 hash = 14695981039346656037ULL;
+};
+
+// A read only file that has been mapped into memory, so we can read it without loading all of it first.
+class MappedFile
+{
+public:
+	MappedFile() {};
+	~MappedFile() { Close(); };
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// Maps a file into memory. Returns false if it doesn't exist or couldn't be mapped.
+	bool Open(const std::string& path);
+	void Close();
+
+	const Uint8* GetData() const { return data; };
+	size_t GetSize() const { return size; };
+
+private:
+	const Uint8* data = nullptr;
+	size_t size = 0;
+
+#ifdef _WIN32
+	void* file = nullptr;
+	void* mapping = nullptr;
+#else
+	int file = -1;
+#endif
+};
+
+// Copies the lighting in a cache file into our tile layers. Returns false, without touching the layers,
+// if there's no cache or if it was made from a level with a different hash.
+bool LoadLightCache(const std::string& path, Uint64 hash, TileLayer* layers, int layerCount);
+
+// Writes the lighting of our tile layers to a cache file.
+bool SaveLightCache(const std::string& path, Uint64 hash, const TileLayer* layers, int layerCount);
+
+#endif
@@ -0,0 +1,174 @@
+#pragma once
+#ifndef LIGHTING_H
+#define LIGHTING_H
+
+#include "SDL/SDL.h"
+#include "rpg/level/tile.h"
+#include "rpg/level/shadows.h"
+
+#include <memory>
+#include <vector>
+#include <cmath>
+
+// Every color a single light can give off, stored by distance. A light's color only depends on
+// the whole number distance from it (see CalculateLightDistance), and it's black past its radius,
+// so this table holds every result CalculateLightingFromDistance could ever give us for this light.
+class LightFalloff
+{
+public:
+	LightFalloff() {};
+	LightFalloff(SDL_Color color, int intensity) { Build(color, intensity); };
+
+	// Fills our table for a light of this color and intensity.
+	void Build(SDL_Color color, int intensity);
+
+	// Grabs the light at an offset (in pixels) from the light's position. This gives the exact same
+	// result as the CalculateLighting functions in light.h.
+	SDL_Color Sample(float x, float y) const
+	{
+		double floorX = floor(x);
+		double floorY = floor(y);
+		double distanceSquared = floorX * floorX + floorY * floorY;
+
+		// Anything past our radius is black, so we don't need to work out the distance.
+		if (distanceSquared > radiusSquared) return { 0, 0, 0 };
+		return table[(int)ceil(sqrt(distanceSquared))];
+	};
+
+	// The furthest distance (in pixels) that this light reaches.
+	int GetRadius() const { return radius; };
+
+	SDL_Color GetColor() const { return color; };
+	int GetIntensity() const { return intensity; };
+
+	// Direct access to our table for the bake kernels. There are (radius + 1) entries.
+	const SDL_Color* GetTable() const { return table.data(); };
+	double GetRadiusSquared() const { return radiusSquared; };
+
+private:
+	SDL_Color color = { 0, 0, 0 };
+	int intensity = 0;
+
+	// The color of the light at each whole number distance, up to and including our radius.
+	std::vector<SDL_Color> table;
+	int radius = -1;
+	double radiusSquared = -1;
+};
+
+// The different ways we can bake lighting, from slowest to fastest. They all give the exact same results.
+enum LightingKernel
+{
+	LIGHTING_KERNEL_SCALAR,
+	LIGHTING_KERNEL_SSE2,
+	LIGHTING_KERNEL_AVX2
+};
+
+// Grabs the fastest kernel this CPU supports.
+LightingKernel GetBestLightingKernel();
+const char* GetLightingKernelName(LightingKernel kernel);
+
+// Adds a light to a set of tiles, saturating each color at 255. Tile positions are split into
+// separate x and y arrays so several tiles can be lit at once.
+void BakeLight(const LightFalloff& falloff, float lightX, float lightY, const float* tileX, const float* tileY,
+	SDL_Color* tileLight, int count, LightingKernel kernel = GetBestLightingKernel());
+
+// Adds a baked light to a set of tiles. Lights with shadows check every tile against their
+// visibility polygon, so they always use the scalar kernel.
+struct BakedLight;
+void BakeLight(const BakedLight& light, const float* tileX, const float* tileY, SDL_Color* tileLight, int count,
+	LightingKernel kernel = GetBestLightingKernel());
+
+class Light;
+
+// A light that has been baked into our tiles. We remember exactly what we baked, so we can
+// take it back out of our tiles when the light changes.
+struct BakedLight
+{
+	BakedLight() {};
+	BakedLight(Light* light);
+
+	// The light this was baked from.
+	Light* light = nullptr;
+
+	// Where the light was, and how it falls off.
+	float x = 0;
+	float y = 0;
+	float radius = 0;
+	LightFalloff falloff;
+
+	// If the light casts shadows, everything it could see when it was baked. Lights that
+	// haven't moved share this with the light they were updated from.
+	bool shadows = false;
+	std::shared_ptr<VisibilityPolygon> shadow;
+
+	// Whether the light has changed since it was baked.
+	bool HasChanged();
+
+	// Whether our shadow is missing or was built somewhere else.
+	bool NeedsShadow() const;
+
+	// The area in level space covering every tile this light reaches.
+	SDL_FRect GetArea() const;
+};
+
+// How many tiles wide and high each cell in a light grid is.
+#define LIGHT_GRID_CELL_SIZE 16
+
+// Splits a tile layer up into cells and remembers which lights can reach each cell, so
+// lighting a tile only has to look at the lights that are actually near it.
+class LightGrid
+{
+public:
+	// Bins our lights into the cells of this layer. Lights are stored by their index in the list.
+	void Build(const TileLayer& layer, const std::vector<BakedLight>& lights);
+
+	// Grabs the lights that can reach a cell.
+	const std::vector<int>& GetLights(int cellX, int cellY) const { return cells[cellY * cellsWide + cellX]; };
+
+	// Works out the first tile, and how many tiles there are, in a cell.
+	void GetCellTiles(int cellX, int cellY, int& column, int& row, int& columns, int& rows) const;
+
+	int cellsWide = 0;
+	int cellsHigh = 0;
+
+private:
+	int layerWidth = 0;
+	int layerHeight = 0;
+	std::vector<std::vector<int>> cells;
+};
+
+// Lights every tile in a layer, only adding the lights from the grid that can reach each tile.
+// Tile positions are in the same order as the layer's tiles. Rows are split up across the worker pool.
+void BakeLayerLighting(TileLayer& layer, const LightGrid& grid, const std::vector<BakedLight>& lights,
+	const float* tileX, const float* tileY, LightingKernel kernel = GetBestLightingKernel());
+
+// Adds a light to (or with a sign of -1, removes a light from) the light totals of a layer.
+// Only the tiles the light reaches are touched.
+void AccumulateLight(TileLayer& layer, const BakedLight& light, int sign);
+
+// Works out the final color of every tile in an area from the layer's light totals.
+void ResolveLight(TileLayer& layer, SDL_FRect area);
+
+// Compares a falloff table against working out the lighting directly for every offset the light
+// can reach, and prints how long each took. Returns false if any of the results are different.
+// Press F5 in the overworld (in debug mode) to run this on every light in the level. It prints a
+// "[LEVEL] Light falloff" line per table with both timings and how many results didn't match.
+bool BenchmarkLightFalloff(const LightFalloff& falloff);
+
+// Runs BenchmarkLightFalloff the first time we see a color and intensity, and skips it after that.
+bool CheckLightFalloffOnce(const LightFalloff& falloff);
+
+// Set this to 1 to check every new falloff table against the real lighting as levels load (in debug
+// mode). Every check sweeps every offset the light reaches, so this is off unless the lighting changes.
+#ifndef CHECK_LIGHT_FALLOFF
+#define CHECK_LIGHT_FALLOFF 0
+#endif
+
+// Set this to 1 to check every baked layer against lighting every tile with every light (in debug mode).
+// This is the exact cost our light grid exists to avoid, and shadowed lights test visibility for every
+// tile on top of that, so it's very slow on big levels. Only turn it on when the bake changes.
+#ifndef CHECK_LIGHT_BAKE
+#define CHECK_LIGHT_BAKE 0
+#endif
+
+#endif
@@ -0,0 +1,56 @@
+#pragma once
+#ifndef LIGHTMAP_H
+#define LIGHTMAP_H
+
+#include "SDL/SDL.h"
+#include "rpg/level/tile.h"
+#include "rpg/level/lighting.h"
+
+#include <memory>
+#include <vector>
+
+// A light that isn't baked into our tiles, such as the light that follows our mouse around.
+// These are added to the lightmap every frame.
+struct DynamicLight
+{
+	const LightFalloff* falloff = nullptr;
+	float x = 0;
+	float y = 0;
+};
+
+// Holds the final light of every tile the camera can see, one pixel per tile. This is drawn over
+// the top of our (unlit) tiles and multiplies them, so lighting a layer is one draw call no
+// matter how many tiles or lights there are.
+class TileLightmap
+{
+public:
+	// Works out the light of every visible tile in a layer (baked and dynamic) and uploads it.
+	// Returns false if none of the layer is visible.
+	bool Update(SDL_Renderer* ren, TileLayer& layer, SDL_FRect camera, const std::vector<DynamicLight>& lights);
+
+	// Multiplies whatever has already been drawn by our lightmap. Tiles with no light at all
+	// are removed completely, just like when they're culled.
+	void Draw(SDL_Renderer* ren, SDL_FRect camera);
+
+	// Releases our texture.
+	void Free();
+
+private:
+	// Makes sure our texture can hold this many tiles.
+	bool CreateTexture(SDL_Renderer* ren, int columns, int rows);
+
+	// One pixel per tile, stretched over the top of the tiles.
+	std::shared_ptr<SDL_Texture> texture;
+	int textureWidth = 0;
+	int textureHeight = 0;
+
+	// The tiles that are in our lightmap this frame, and where they are in level space.
+	SDL_FRect area = { 0, 0, 0, 0 };
+	int columns = 0;
+	int rows = 0;
+
+	// The light of each tile before it's uploaded. Kept around so we're not reallocating it every frame.
+	std::vector<SDL_Color> light;
+};
+
+#endif
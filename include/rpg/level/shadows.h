@@ -0,0 +1,44 @@
+#pragma once
+#ifndef SHADOWS_H
+#define SHADOWS_H
+
+#include "SDL/SDL.h"
+#include "rpg/level/tile.h"
+
+#include <vector>
+
+// How long (in milliseconds) we're allowed to spend rebuilding shadows each frame. Lights that
+// move while we're over budget keep their old lighting until the next frame.
+#define SHADOW_FRAME_BUDGET 2.0
+
+// Everything a light can see, found by casting rays out from the light at the corners of every
+// collision rectangle around it. The polygon is stored as a fan of points sorted by angle, so
+// checking if a point is lit is just a binary search and a single edge test.
+class VisibilityPolygon
+{
+public:
+	// Casts rays from a light against the edges of these rectangles. Rectangles the light
+	// is inside of are ignored, otherwise the light couldn't see anything at all.
+	void Build(float lightX, float lightY, float lightRadius, const std::vector<SDL_FRect>& occluders);
+
+	// Whether the light can see a point in level space.
+	bool IsVisible(float pointX, float pointY) const;
+
+	// Whether the light can see a tile, given the top left of the tile. We check a point just inside
+	// the side of the tile facing the light, so walls are lit on the side the light can see.
+	bool IsTileVisible(float tileX, float tileY) const;
+
+	// The area (in level space) that rectangles need to be in to cast a shadow for a light.
+	static SDL_FRect GetBounds(float lightX, float lightY, float lightRadius);
+
+	// Where the light was when this was built.
+	float x = 0;
+	float y = 0;
+	float radius = 0;
+
+	// Every point of our polygon, and its angle from the light, sorted by angle.
+	std::vector<float> angles;
+	std::vector<SDL_FPoint> points;
+};
+
+#endif
@@ -0,0 +1,101 @@
+#pragma once
+#ifndef SPATIALHASH_H
+#define SPATIALHASH_H
+
+#include "SDL/SDL.h"
+
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+// The default size of a cell in a spatial hash, in pixels.
+#define SPATIAL_HASH_CELL_SIZE 256
+
+// Splits the level up into a uniform grid of cells and remembers which items touch which
+// cells. Asking for everything in an area then only looks at the cells that area touches,
+// so it doesn't matter how big the level is or how many items are in it.
+template <typename T>
+class SpatialHash
+{
+public:
+	SpatialHash(float size = SPATIAL_HASH_CELL_SIZE) : cellSize(size) {};
+
+	// Adds an item that covers an area in level space.
+	void Insert(const T& item, SDL_FRect area)
+	{
+		int firstX, firstY, lastX, lastY;
+		GetCellRange(area, firstX, firstY, lastX, lastY);
+
+		for (int y = firstY; y <= lastY; y++)
+		{
+			for (int x = firstX; x <= lastX; x++)
+			{
+				cells[GetKey(x, y)].push_back(item);
+			}
+		}
+	};
+
+	// Removes an item. The area needs to be the same as the one it was inserted with.
+	void Remove(const T& item, SDL_FRect area)
+	{
+		int firstX, firstY, lastX, lastY;
+		GetCellRange(area, firstX, firstY, lastX, lastY);
+
+		for (int y = firstY; y <= lastY; y++)
+		{
+			for (int x = firstX; x <= lastX; x++)
+			{
+				auto iter = cells.find(GetKey(x, y));
+				if (iter == cells.end()) continue;
+
+				auto& cell = iter->second;
+				cell.erase(std::remove(cell.begin(), cell.end(), item), cell.end());
+				if (cell.empty()) cells.erase(iter);
+			}
+		}
+	};
+
+	// Grabs every item in the cells this area touches. These are only items that could be
+	// touching the area, it's up to the caller to do a proper check. Each item is only
+	// returned once.
+	void Query(SDL_FRect area, std::vector<T>& out)
+	{
+		int firstX, firstY, lastX, lastY;
+		GetCellRange(area, firstX, firstY, lastX, lastY);
+
+		size_t start = out.size();
+		for (int y = firstY; y <= lastY; y++)
+		{
+			for (int x = firstX; x <= lastX; x++)
+			{
+				auto iter = cells.find(GetKey(x, y));
+				if (iter == cells.end()) continue;
+				out.insert(out.end(), iter->second.begin(), iter->second.end());
+			}
+		}
+
+		// Items that cover more than one cell will be in here more than once.
+		std::sort(out.begin() + start, out.end());
+		out.erase(std::unique(out.begin() + start, out.end()), out.end());
+	};
+
+	// Removes everything.
+	void Clear() { cells.clear(); };
+
+private:
+	float cellSize;
+	std::unordered_map<long long, std::vector<T>> cells;
+
+	long long GetKey(int x, int y) { return ((long long)x << 32) | (unsigned int)y; };
+
+	void GetCellRange(SDL_FRect area, int& firstX, int& firstY, int& lastX, int& lastY)
+	{
+		firstX = (int)floor(area.x / cellSize);
+		firstY = (int)floor(area.y / cellSize);
+		lastX = (int)floor((area.x + area.w) / cellSize);
+		lastY = (int)floor((area.y + area.h) / cellSize);
+	};
+};
+
+#endif
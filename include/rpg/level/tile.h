@@ -2,29 +2,89 @@
 #define TILE_H
 
 #define MAX_TILE_LAYERS 16
+#define TILE_SIZE 64
+
+// Tiled stores whether a tile is flipped or rotated in the top bits of its ID. We don't support
+// either, so these are masked off and the tile is drawn as it is in the tileset.
+#define TILE_FLIP_FLAGS 0xF0000000u
 
 #include "SDL/SDL.h"
-#include "rpg/base/renderable.h"
-#include "rpg/base/taggable.h"
 #include "rpg/level/tileset.h"
 #include <memory>
+#include <vector>
+#include <algorithm>
+#include <cmath>
 
-// The visual representation of a tile.
-class Tile : public Renderable, public Taggable
+// A layer of tiles laid out on a regular grid, read from left to right and then top to bottom.
+// We don't store a whole object per tile, just its ID in the tileset and its lighting. Anything
+// else about a tile is looked up from the tileset.
+struct TileLayer
 {
-public:
-	// Constructors for this tile.
-	Tile();
-	Tile(float x, float y, TileData data);
+	// The size of this layer in tiles.
+	int width = 0;
+	int height = 0;
+
+	// The position of the top left tile in level space.
+	float x = 0;
+	float y = 0;
+
+	// The tileset ID of every tile. The tile at a column and row is stored at (row * width + column).
+	// An ID of zero means there's no tile there.
+	std::vector<Uint16> tiles;
+
+	// The baked lighting of every tile, stored the same way as our tiles.
+	std::vector<SDL_Color> light;
+
+	// The total red, green and blue light added to every tile before it's clamped, three values per
+	// tile. This is only filled in once a light changes, so it can be taken back out again.
+	std::vector<Uint16> lightTotals;
 
+	// The tileset our tiles come from, and the texture they're all drawn from.
+	Tileset* tileset = nullptr;
 	std::shared_ptr<SDL_Texture> texture;
-	TileData data;
 
-	// Color modifier for this Tile - This is primarily used for lighting.
-	SDL_Color colorModifier;
+	// Grabbers for a single tile.
+	Uint16			GetTileID(int column, int row) const { return tiles[row * width + column]; }
+	SDL_Color&		GetLight(int column, int row) { return light[row * width + column]; }
+	const TileData&	GetTileData(int column, int row) { return tileset->tiles[GetTileID(column, row)]; }
+
+	// The position of the top left of a tile in level space.
+	float GetTileX(int column) const { return x + (float)(column * TILE_SIZE); }
+	float GetTileY(int row) const { return y + (float)(row * TILE_SIZE); }
+
+	// Works out the columns and rows of the tiles that touch an area in level space. Returns
+	// false if no tiles in this layer touch the area.
+	bool GetTileRange(SDL_FRect area, int& firstColumn, int& firstRow, int& lastColumn, int& lastRow) const
+	{
+		if (width <= 0 || height <= 0) return false;
+
+		firstColumn = std::max((int)floor((area.x - x) / TILE_SIZE), 0);
+		firstRow = std::max((int)floor((area.y - y) / TILE_SIZE), 0);
+		lastColumn = std::min((int)ceil((area.x + area.w - x) / TILE_SIZE) - 1, width - 1);
+		lastRow = std::min((int)ceil((area.y + area.h - y) / TILE_SIZE) - 1, height - 1);
+
+		return firstColumn <= lastColumn && firstRow <= lastRow;
+	}
+
+	// Works out which tile a position in level space is on. Returns false if it's outside of this layer.
+	bool GetTileAt(float levelX, float levelY, int& column, int& row) const
+	{
+		column = (int)floor((levelX - x) / TILE_SIZE);
+		row = (int)floor((levelY - y) / TILE_SIZE);
+		return column >= 0 && row >= 0 && column < width && row < height;
+	}
 
-	// Render the tile to the screen.
-	void Draw(SDL_Window* win, SDL_Renderer* ren);
- };
+	// Releases all of our tiles.
+	void Free()
+	{
+		tiles.clear();
+		light.clear();
+		lightTotals.clear();
+		texture.reset();
+		tileset = nullptr;
+		width = 0;
+		height = 0;
+	}
+};
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,79 @@
+#pragma once
+#ifndef TILECHUNK_H
+#define TILECHUNK_H
+
+#include "SDL/SDL.h"
+#include "rpg/level/tile.h"
+#include "rpg/base/spritebatch.h"
+
+#include <memory>
+#include <vector>
+
+// How many tiles wide and high a single chunk is.
+#define TILE_CHUNK_SIZE		16
+#define TILE_CHUNK_PIXELS	(TILE_CHUNK_SIZE * TILE_SIZE)
+
+// A block of tiles that has been rendered into a single texture.
+struct TileChunk
+{
+	// The area this chunk covers in level space.
+	SDL_FRect bounds = { 0, 0, 0, 0 };
+
+	// The first column and row of the tiles in this chunk, and how many of them we have.
+	int column = 0;
+	int row = 0;
+	int columns = 0;
+	int rows = 0;
+
+	// The texture all of our tiles were rendered into.
+	std::shared_ptr<SDL_Texture> texture;
+
+	// If something in this chunk has changed and the texture needs to be rendered again.
+	bool dirty = true;
+};
+
+// Caches a tile layer as a handful of pre-rendered textures so we don't have to
+// draw every single tile every single frame. Tiles never change after a level is loaded,
+// so we only redraw a chunk when it's been invalidated. Chunks are drawn unlit, lighting
+// is added on top of them by a TileLightmap.
+class TileChunkCache
+{
+public:
+	// Splits a tile layer up into chunks. Textures are rendered on the next Draw().
+	void Build(TileLayer* tileLayer);
+
+	// Marks every chunk touching this area (in level space) as needing to be rendered again.
+	void Invalidate(SDL_FRect area);
+	void InvalidateAll();
+
+	// Throws away every chunk's texture, for when the renderer has lost them. They're created
+	// again and re-rendered the next time they're drawn.
+	void ReleaseTextures();
+
+	// Renders any invalidated chunks and then draws every chunk that the camera can see.
+	// Returns the amount of chunks that were drawn.
+	int Draw(SDL_Renderer* ren, SDL_FRect camera);
+
+	// Releases all of our chunks and their textures.
+	void Free();
+
+private:
+	// The layer we're caching.
+	TileLayer* layer = nullptr;
+
+	// All of our chunks. The chunk at a chunk column and row is stored at (row * chunksWide + column).
+	std::vector<TileChunk> chunks;
+	int chunksWide = 0;
+	int chunksHigh = 0;
+
+	// Works out the chunk columns and rows that touch an area in level space.
+	bool GetChunkRange(SDL_FRect area, int& firstColumn, int& firstRow, int& lastColumn, int& lastRow);
+
+	// Renders all of the tiles in a chunk into the chunk's texture.
+	bool RenderChunk(SDL_Renderer* ren, TileChunk& chunk);
+
+	// Used to draw all of a chunk's tiles at once.
+	SpriteBatch batch;
+};
+
+#endif
@@ -31,7 +31,7 @@ struct Tileset
 	// Releases all of our tile textures.
 	void FreeTiles();
 
-	TileData GetTile(int tileID) { return tiles[tileID]; }
+	const TileData& GetTile(int tileID) { return tiles[tileID]; }
 };
 
 #endif
\ No newline at end of file
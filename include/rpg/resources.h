@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <functional>
 #include "SDL/SDL_image.h"
 #include "SDL/SDL_ttf.h"
 
@@ -54,9 +55,11 @@ public:
     bool Initalize();
     void Shutdown();
  
-    // Fading functions.
-    void FadeFromBlack(float duration);
-    void FadeToBlack(float duration);
+    // Fading functions. onFinished is called once the fade is over. If we're already fading, the
+    // new fade is ignored but onFinished is still called when the current fade is over, along with
+    // everything else that was waiting on it.
+    void FadeFromBlack(float duration, std::function<void()> onFinished = nullptr);
+    void FadeToBlack(float duration, std::function<void()> onFinished = nullptr);
     void ResetFade();
     void ApplyGlobalFade(SDL_Color color);
     bool currentlyFading;
@@ -68,6 +71,10 @@ private:
     float fadeDelta;
     float fadeProgress;
     int fadeType = -1;
+    std::vector<std::function<void()>> fadeFinished;
+
+    // Stops fading and lets everyone waiting on the fade know.
+    void FinishFade();
 };
 
 // Python module init function. This is required in every header file for classes that
@@ -25,7 +25,7 @@ public:
 	bool			TilesetExists(std::string texture);
 	// Removes a tileset and frees it.
 	bool			RemoveTileset(std::string texture);
-	// Returns a tileset.
-	Tileset			GetTileset(std::string texture);
+	// Returns a pointer to a tileset, or nullptr if it doesn't exist.
+	Tileset*		GetTileset(std::string texture);
 };
 #endif
\ No newline at end of file
@@ -18,13 +18,24 @@
 #include "rpg/engine.h"						// Defines the engine class.
 #include "rpg/gui/base.h"					// Base class for GUI elements and a GUI object for states.
 #include "rpg/entity.h"						// Base class for entities.
+#include "rpg/entityhandle.h"					// Safe references to entities.
+#include "rpg/entityfactory.h"					// Creates entities from their type.
 #include "rpg/gamestate.h"					// Base class for gamestates.
 #include "rpg/base/inputtable.h"			// Base class that adds inputtable functionality.
 #include "rpg/base/renderable.h"			// Base class for renderable SDL objects.
 #include "rpg/base/taggable.h"				// Base class that includes unique-tagging functions.
+#include "rpg/base/spritebatch.h"			// Batches sprites into one draw call.
+#include "rpg/base/workerpool.h"			// Threads for splitting up work.
 #include "rpg/level/level.h"				// Level class.
-#include "rpg/level/tile.h"					// Tile class.
+#include "rpg/level/tile.h"					// Tile layers.
 #include "rpg/level/tileset.h"				// Tileset class.
+#include "rpg/level/tilechunk.h"			// Pre-rendered chunks of tiles.
+#include "rpg/level/spatialhash.h"			// Spatial hash for quickly finding things in an area.
+#include "rpg/level/components.h"			// Packed entity data for per-frame systems.
+#include "rpg/level/shadows.h"				// Shadows cast by collision.
+#include "rpg/level/lighting.h"				// Precomputed light falloff.
+#include "rpg/level/lightmap.h"				// Per-frame tile lighting.
+#include "rpg/level/lightcache.h"			// Baked lighting saved between loads.
 #include "rpg/resources.h"					// Resource class.
 #include "rpg/resources/dialoguemanager.h"	// Dialogue manager resource.
 #include "rpg/resources/fontmanager.h"		// Font manager resource.
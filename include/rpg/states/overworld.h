@@ -6,6 +6,13 @@
 #include "rpg/level/level.h"
 #include "rpg/gamestate.h"
 #include "rpg/gui/base.h"
+#include "rpg/base/spritebatch.h"
+#include "rpg/level/lighting.h"
+#include "rpg/level/lightmap.h"
+
+// The light that follows our mouse around.
+#define MOUSE_LIGHT_COLOR		SDL_Color{ 255, 255, 255 }
+#define MOUSE_LIGHT_INTENSITY	60
 
 enum DEBUG_SELECTION_TYPE
 {
@@ -63,8 +70,26 @@ public:
 	// Offsets the camera by a certain amount.
 	void OffsetCamera(int x, int y);
 
+	// Times every falloff table in our level against working out the lighting directly, and checks
+	// they match. Press F5 in debug mode to run this.
+	void BenchmarkLighting();
+
+	// The renderer has lost every texture we've created. Throws away the textures we render into so
+	// they're created again the next time we draw.
+	void OnRenderDeviceReset();
+
+	// Lets scripts change every light with this name. Tiles the lights reach are relit straight away.
+	void SetLightColor(std::string targetname, int r, int g, int b);
+	void SetLightIntensity(std::string targetname, int intensity);
+	void SetLightPosition(std::string targetname, float x, float y);
+
+	// Lets scripts hold onto an entity across frames. The handle stops working once the entity is destroyed,
+	// so scripts can look an entity up once and keep it instead of searching for it every time.
+	EntityHandle FindEntity(std::string targetname);
+	bool SetEntityPosition(EntityHandle entity, float x, float y);
+
 	// Debug.
-	int tilesRendered = 0;
+	int tileDrawCalls = 0; // How many draw calls our tile layers took last frame. Shown in the debug text.
 	int selection = SELECT_LIGHTING;
 	int lightingRenderType = LIGHTING_STANDARD;
 	int tileCullingType = CULLING_STANDARD;
@@ -81,6 +106,29 @@ public:
 	// Drawing function for our state.
 	void Draw(SDL_Window* win, SDL_Renderer* ren);
 
+	// Drawing functions for our tile layers.
+	SDL_Color	CalculateTileLighting(TileLayer& tileLayer, int column, int row, float mouseX, float mouseY);
+	void		DrawTileLayer(SDL_Window* win, SDL_Renderer* ren, int layer, float mouseX, float mouseY);
+	void		DrawTileLayerChunks(SDL_Window* win, SDL_Renderer* ren, int layer, float mouseX, float mouseY);
+
+	// Works out the light falling on an entity from the tiles under it and our dynamic lights.
+	SDL_Color	CalculateEntityLighting(Entity* entity, float mouseX, float mouseY);
+
+	// Draws the outline of every collision rectangle the camera can see. Only used in debug mode.
+	void		DrawCollision(SDL_Renderer* ren);
+
+	// Collects our tiles so they can be drawn in one go.
+	SpriteBatch tileBatch;
+
+	// Every color the light that follows our mouse can give off.
+	LightFalloff mouseLight;
+
+	// The lighting for the tile layer we're drawing, and the texture each layer is drawn into
+	// before it's lit and put on screen.
+	TileLightmap tileLightmap;
+	std::shared_ptr<SDL_Texture> layerTarget;
+	SDL_Texture* GetLayerTarget(SDL_Renderer* ren);
+
 	// If we get a keyboard event, intercept it and pass it onto our GUI and entities.
 	void OnKeyboardInput(SDL_Keycode keyCode, bool pressed, bool released, bool repeat);
 
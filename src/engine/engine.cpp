@@ -50,6 +50,22 @@ void Engine::Update(double dT)
             case SDL_MOUSEWHEEL:
             {
                 gameState->OnMouseWheelScrolled(event.wheel.x, event.wheel.y, -1);
+                break;
+            }
+
+            // The contents of our render targets have been lost, anything we've rendered
+            // into a texture needs to be rendered again.
+            case SDL_RENDER_TARGETS_RESET:
+            {
+                if (GetOverworldState()->gLevel != nullptr) GetOverworldState()->gLevel->InvalidateAllTiles();
+                break;
+            }
+
+            // The textures themselves have been lost, so the ones we render into need to be created again.
+            case SDL_RENDER_DEVICE_RESET:
+            {
+                GetOverworldState()->OnRenderDeviceReset();
+                break;
             }
         }
     }
@@ -95,9 +111,21 @@ BOOST_PYTHON_MODULE(engine)
 {
     using namespace boost;
 
+    // Entity handles are the only way scripts get to hold onto entities, so they can never outlive them.
+    python::class_<EntityHandle>("EntityHandle")
+        .def("IsValid", &EntityHandle::IsValid)
+        .def(python::self == python::self)
+        .def(python::self != python::self)
+        ;
+
     // Define all of our OverworldState functions that we're exposing to Python.
     python::class_<OverworldState>("OverworldState")
         .def("OffsetCamera", &OverworldState::OffsetCamera, python::args("x", "y"))
+        .def("SetLightColor", &OverworldState::SetLightColor, python::args("targetname", "r", "g", "b"))
+        .def("SetLightIntensity", &OverworldState::SetLightIntensity, python::args("targetname", "intensity"))
+        .def("SetLightPosition", &OverworldState::SetLightPosition, python::args("targetname", "x", "y"))
+        .def("FindEntity", &OverworldState::FindEntity, python::args("targetname"))
+        .def("SetEntityPosition", &OverworldState::SetEntityPosition, python::args("entity", "x", "y"))
         ;
 
     // Define the Engine class. This will encompass everything that we've defined up to this point.
@@ -13,8 +13,8 @@ bool Resources::Initalize()
         return false;
     }
 
-    // Create the renderer for our window.
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    // Create the renderer for our window. We render into textures for things like our tile chunks.
+    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE);
 
     // Is our renderer valid?
     if( renderer == NULL )
@@ -82,8 +82,7 @@ void Resources::RenderMisc()
                 // If our fade is zero, stop fading.
                 if (fadeColor.a == 0)
                 {
-                    this->currentlyFading = false;
-                    fadeType = -1;
+                    FinishFade();
                 }
                 break;
             }
@@ -96,8 +95,7 @@ void Resources::RenderMisc()
                 // If our fade is zero, stop fading.
                 if (fadeColor.a == 255)
                 {
-                    this->currentlyFading = false;
-                    fadeType = -1;
+                    FinishFade();
                 }
                 break;
             }
@@ -113,10 +111,15 @@ void Resources::FinishRender()
     SDL_RenderPresent( renderer );
 }
 
-void Resources::FadeFromBlack(float duration)
+void Resources::FadeFromBlack(float duration, std::function<void()> onFinished)
 {
     // Are we currently fading?
-    if (this->currentlyFading) return;
+    if (this->currentlyFading)
+    {
+        if (onFinished) fadeFinished.push_back(onFinished);
+        return;
+    }
+    if (onFinished) fadeFinished.push_back(onFinished);
 
     // Set our SDL_Rect color to be completely black.
     fadeColor = { 0, 0, 0, 255 };
@@ -132,10 +135,15 @@ void Resources::FadeFromBlack(float duration)
     return;
 }
 
-void Resources::FadeToBlack(float duration)
+void Resources::FadeToBlack(float duration, std::function<void()> onFinished)
 {
     // Are we currently fading?
-    if (this->currentlyFading) return;
+    if (this->currentlyFading)
+    {
+        if (onFinished) fadeFinished.push_back(onFinished);
+        return;
+    }
+    if (onFinished) fadeFinished.push_back(onFinished);
 
     // Set our SDL_Rect color to be completely black.
     fadeColor = { 0, 0, 0, 0 };
@@ -158,11 +166,23 @@ void Resources::ResetFade()
     currentlyFading = false;
     fadeDelta = 0;
     fadeType = -1;
+    fadeFinished.clear();
 
     // Our renderer should handle the rest.
     return;
 }
 
+void Resources::FinishFade()
+{
+    currentlyFading = false;
+    fadeType = -1;
+
+    // Grab the callbacks first, they might start another fade.
+    std::vector<std::function<void()>> onFinished;
+    onFinished.swap(fadeFinished);
+    for (auto& callback : onFinished) callback();
+}
+
 void Resources::ApplyGlobalFade(SDL_Color color)
 {
     // Applies a basic faded effect over the entire screen.
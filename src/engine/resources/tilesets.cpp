@@ -32,14 +32,14 @@ void TilesetManager::Initalize()
     }
 }
 
-Tileset TilesetManager::GetTileset(std::string tilesetPath)
+Tileset* TilesetManager::GetTileset(std::string tilesetPath)
 {
     // Double check to see if this tileset exists.
-    if (!TilesetExists(tilesetPath)) return {};
+    if (!TilesetExists(tilesetPath)) return nullptr;
 
     // Find our tileset with the tileset path.
     auto iter = tilesets.find(tilesetPath);
-    return iter->second;
+    return &iter->second;
 }
 
 bool TilesetManager::TilesetExists(std::string tilesetPath)
@@ -55,9 +55,9 @@ bool TilesetManager::RemoveTileset(std::string tilesetPath)
     if (!TilesetExists(tilesetPath)) return false;
 
     // Get the tileset from our map of tilesets.
-    Tileset tileset = GetTileset(tilesetPath);
+    Tileset* tileset = GetTileset(tilesetPath);
     
-    tileset.FreeTiles();
+    tileset->FreeTiles();
 
     // Remove this tileset from the map.
     tilesets.erase(tilesetPath);
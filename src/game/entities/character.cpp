@@ -1,12 +1,20 @@
 #include "rpg/rpg.h"
 #include "rpg/states/overworld.h"
 
+#include <limits>
+
+// There's only ever one character in a level.
+static EntityRegistration<Character> characterRegistration("character", nullptr, true);
+
 Character::Character() : Entity()
 {
     // This entity can collide with other entities.
     this->AddTag(Tag_Renderable);
     this->AddTag(Tag_Collision);
-    this->AddTag("Character");
+    this->AddTag(Tag_Character);
+
+    // We need to move around every frame.
+    this->hasScript = true;
 
     // Load all of our textures.
     textures[0] = EngineResources.textures.GetTexture("assets/sprites/character/chara_front.png");
@@ -46,7 +54,7 @@ void Character::OnKeyboardInput(SDL_Keycode keyCode, bool pressed, bool released
     // add support for it here.
 
     // Are we allowed to move?
-    if (HasTag("DontMove"))
+    if (HasTag(Tag_DontMove))
     {
         up = false;
         down = false;
@@ -157,18 +165,87 @@ bool SDL_FIntersectRect(SDL_FRect a, SDL_FRect b)
     return true;
 }
 
-bool DoesAnythingIntersect(SDL_FRect testRect)
+// Sweeps a rectangle along a movement and works out when (from 0 to 1) it first hits
+// another rectangle, and which side of it we hit. Rectangles that only touch don't count,
+// and neither do rectangles we're already inside of, so we can always move out of them.
+// The only exception is if we're barely inside of one (see CHARACTER_COLLISION_EPSILON) and
+// moving further in, which counts as hitting it straight away.
+static bool SweepRect(SDL_FRect moving, float dx, float dy, SDL_FRect other, float& hitTime, int& normalX, int& normalY)
 {
-    if (GameEngine->GetOverworldState()->gLevel == nullptr) return false;
-    // Do collision detection with all of our collision objects in the level.
-    for (auto& collisionRect : GameEngine->GetOverworldState()->gLevel->lCollisionR)
+    const float infinity = std::numeric_limits<float>::infinity();
+    float entryX, exitX, entryY, exitY;
+
+    if (dx > 0)
     {
-        if (SDL_FIntersectRect(collisionRect.collisionRect, testRect))
-        {
-            return true;
-        }
+        entryX = (other.x - (moving.x + moving.w)) / dx;
+        exitX = ((other.x + other.w) - moving.x) / dx;
+    }
+    else if (dx < 0)
+    {
+        entryX = ((other.x + other.w) - moving.x) / dx;
+        exitX = (other.x - (moving.x + moving.w)) / dx;
+    }
+    else
+    {
+        // Not moving on this axis, so we either always overlap on it or never will.
+        if (moving.x + moving.w <= other.x || moving.x >= other.x + other.w) return false;
+        entryX = -infinity;
+        exitX = infinity;
+    }
+
+    if (dy > 0)
+    {
+        entryY = (other.y - (moving.y + moving.h)) / dy;
+        exitY = ((other.y + other.h) - moving.y) / dy;
+    }
+    else if (dy < 0)
+    {
+        entryY = ((other.y + other.h) - moving.y) / dy;
+        exitY = (other.y - (moving.y + moving.h)) / dy;
+    }
+    else
+    {
+        if (moving.y + moving.h <= other.y || moving.y >= other.y + other.h) return false;
+        entryY = -infinity;
+        exitY = infinity;
+    }
+
+    // We only hit if we've started overlapping on both axes before we've stopped overlapping
+    // on either of them, and that happens during this movement.
+    float entry = std::max(entryX, entryY);
+    float exit = std::min(exitX, exitY);
+    if (entry >= exit || entry > 1) return false;
+
+    // We started off overlapping. Work out how far inside we are on the side we're moving into.
+    if (entry < 0)
+    {
+        float depth = entryX > entryY ? -entryX * std::abs(dx) : -entryY * std::abs(dy);
+        if (!(depth <= CHARACTER_COLLISION_EPSILON)) return false;
+        entry = 0;
     }
-    return false;
+
+    // The axis we started overlapping on last is the side we hit.
+    hitTime = entry;
+    normalX = 0;
+    normalY = 0;
+    if (entryX > entryY) normalX = dx > 0 ? -1 : 1;
+    else normalY = dy > 0 ? -1 : 1;
+    return true;
+}
+
+// Pushes a rectangle out of another one it's overlapping, along whichever side is closest.
+static void PushOutOfRect(SDL_FRect& box, SDL_FRect other)
+{
+    float left = (box.x + box.w) - other.x;
+    float right = (other.x + other.w) - box.x;
+    float top = (box.y + box.h) - other.y;
+    float bottom = (other.y + other.h) - box.y;
+
+    float shortest = std::min(std::min(left, right), std::min(top, bottom));
+    if (shortest == left) box.x = other.x - box.w;
+    else if (shortest == right) box.x = other.x + other.w;
+    else if (shortest == top) box.y = other.y - box.h;
+    else box.y = other.y + other.h;
 }
 
 void Character::HandleMovement()
@@ -176,69 +253,104 @@ void Character::HandleMovement()
     // If we're currently in the middle of a fade, don't do any movement.
     if (EngineResources.currentlyFading) return;
 
-    // Set the position of our collison rect.
-    collisionRect.x = destinationRect.x;
-    collisionRect.y = destinationRect.y + (destinationRect.h / 4);
+    // Set the position of our collison rect. This is in level space, just like the level's collision.
+    collisionRect.x = levelX;
+    collisionRect.y = levelY + (destinationRect.h / 4);
+
+    // Work out how far we want to move this frame. Long frames (like the one after loading a level)
+    // are capped so we don't suddenly jump across the screen.
+    float distance = CHARACTER_SPEED * std::min(dT, CHARACTER_MAX_DELTA);
+    float dx = 0;
+    float dy = 0;
+    if (up) dy -= distance;
+    if (down) dy += distance;
+    if (left) dx -= distance;
+    if (right) dx += distance;
+
+    // If we aren't moving, there's nothing to do.
+    if (dx == 0 && dy == 0) return;
+
+    Level* level = GameEngine->GetOverworldState()->gLevel;
+    if (level == nullptr) return;
+
+    // If we've somehow ended up inside of something, get out of it before we go anywhere.
+    SDL_FRect box = collisionRect;
+    std::vector<CollisionRect*> nearby;
+    level->QueryCollision(box, nearby);
+    for (auto& collision : nearby)
+    {
+        if (SDL_FIntersectRect(box, collision->rect)) PushOutOfRect(box, collision->rect);
+    }
+
+    // Grab everything we could possibly hit along the way in one go, from wherever we were pushed
+    // out to. Sliding never takes us outside of the area covered by our full movement.
+    SDL_FRect sweptArea = box;
+    sweptArea.x = std::min(box.x, box.x + dx);
+    sweptArea.y = std::min(box.y, box.y + dy);
+    sweptArea.w += std::abs(dx);
+    sweptArea.h += std::abs(dy);
+
+    nearby.clear();
+    level->QueryCollision(sweptArea, nearby);
 
-    // If we are moving...
-    if (up || down || left || right)
+    // Move until we hit something, then slide along it with whatever movement we have left.
+    for (int i = 0; i < CHARACTER_MAX_SLIDES && (dx != 0 || dy != 0); i++)
     {
-        float baseSpeed = 5;
-        float upSpeed = baseSpeed;
-        float downSpeed = baseSpeed;
-        float leftSpeed = baseSpeed;
-        float rightSpeed = baseSpeed;
+        float hitTime = 1;
+        int normalX = 0, normalY = 0;
+        CollisionRect* hit = nullptr;
 
-        if (up)
+        for (auto& collision : nearby)
         {
-            // Set where our collision rect will be.
-            SDL_FRect testRect = collisionRect;
-            testRect.y += -6;
-
-            // Test if we're colliding with anything in the level.
-            if (!DoesAnythingIntersect(testRect))
+            float time;
+            int x, y;
+            if (SweepRect(box, dx, dy, collision->rect, time, x, y) && time < hitTime)
             {
-                Move(0, -upSpeed);
+                hitTime = time;
+                normalX = x;
+                normalY = y;
+                hit = collision;
             }
         }
 
-        if (down)
+        // Nothing in our way.
+        if (hit == nullptr)
         {
-            // Set where our collision rect will be.
-            SDL_FRect testRect = collisionRect;
-            testRect.y += 6;
-
-            // Test if we're colliding with anything in the level.
-            if (!DoesAnythingIntersect(testRect))
-            {
-                Move(0, downSpeed);
-            }
+            box.x += dx;
+            box.y += dy;
+            break;
         }
-        if (left)
-        {
-            // Set where our collision rect will be.
-            SDL_FRect testRect = collisionRect;
-            testRect.x += -6;
 
-            // Test if we're colliding with anything in the level.
-            if (!DoesAnythingIntersect(testRect))
-            {
-                Move(-leftSpeed, 0);
-            }
+        // Move up to what we hit. We snap to its edge so floating point errors never leave
+        // us slightly inside of it.
+        box.x += dx * hitTime;
+        box.y += dy * hitTime;
+        if (normalX < 0) box.x = hit->rect.x - box.w;
+        if (normalX > 0) box.x = hit->rect.x + hit->rect.w;
+        if (normalY < 0) box.y = hit->rect.y - box.h;
+        if (normalY > 0) box.y = hit->rect.y + hit->rect.h;
+
+        // Slide along the side we hit.
+        float remaining = 1 - hitTime;
+        if (normalX != 0)
+        {
+            dx = 0;
+            dy *= remaining;
         }
-        if (right)
+        else
         {
-            // Set where our collision rect will be.
-            SDL_FRect testRect = collisionRect;
-            testRect.x += 6;
-
-            // Test if we're colliding with anything in the level.
-            if (!DoesAnythingIntersect(testRect))
-            {
-                Move(rightSpeed, 0);
-            }
+            dy = 0;
+            dx *= remaining;
         }
     }
+
+    // Take our position straight from where we ended up, rather than adding up the difference,
+    // so we don't pick up any more floating point error on the way.
+    float newX = box.x;
+    float newY = box.y - (destinationRect.h / 4);
+    Move(newX - levelX, newY - levelY);
+    levelX = newX;
+    levelY = newY;
 }
 
 void Character::HandleUsing()
@@ -251,28 +363,29 @@ void Character::HandleUsing()
     // event until we're out of it.
     if (this->isCurrentlyUsed) return;
 
-    for (auto& entLayer : GameEngine->GetOverworldState()->gLevel->lEntities)
+    // Every entity has its own use distance, so grab everything within the furthest one
+    // and then check each entity's distance properly.
+    Level* level = GameEngine->GetOverworldState()->gLevel;
+    std::vector<Entity*> nearby;
+    level->QueryEntitiesInRadius(this->levelOriginX(), this->levelOriginY(), level->lMaxUseDistance, nearby);
+
+    for (auto& ent : nearby)
     {
-        for (auto& ent : entLayer)
-        {
-            // If this is us, what the heck are we doing?
-            if (ent.get() == this) continue;
+        // If this is us, what the heck are we doing?
+        if (ent == this) continue;
 
-            // Calculate distance.
-            float x = this->originX() - ent->originX();
-            float y = this->originY() - ent->originY();
-            float dist = sqrt(pow(x, 2) + pow(y, 2));
+        // Calculate distance. Squared distances compare the same way as real ones.
+        float x = this->levelOriginX() - ent->levelOriginX();
+        float y = this->levelOriginY() - ent->levelOriginY();
 
-            // Can we use this ent?
-            if (dist <= ent->useDistance)
-            {
-                // Perform our use ability.
-                ent->OnUse(this);
-                ent->isCurrentlyUsed = true;
-                this->isCurrentlyUsed = true;
-            }
+        // Can we use this ent?
+        if (x * x + y * y <= ent->useDistance * ent->useDistance)
+        {
+            // Perform our use ability.
+            ent->OnUse(this);
+            ent->isCurrentlyUsed = true;
+            this->isCurrentlyUsed = true;
         }
-
     }
 }
 
@@ -281,6 +394,7 @@ void Character::Draw(SDL_Window* win, SDL_Renderer* ren)
 {
     // Render our character.
     Renderable::Draw(win, ren);
+    SDL_SetTextureColorMod(this->activeTexture.get(), lighting.r, lighting.g, lighting.b);
     SDL_RenderCopyF(ren, this->activeTexture.get(), NULL, &renderedRectangle);
     return;
 }
\ No newline at end of file
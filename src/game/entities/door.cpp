@@ -2,45 +2,39 @@
 #include "rpg/entities/door.h"
 #include "rpg/states/overworld.h"
 
+static const PropertySchema<DoorProperties> doorSchema = PropertySchema<DoorProperties>()
+	.Add("level", &DoorProperties::levelDestination)
+	.Add("landmark_entity", &DoorProperties::landmarkName)
+	.Add("enabled", &DoorProperties::enabled);
+
+static EntityRegistration<DoorEntity> doorRegistration("door", doorSchema.Parser(&DoorEntity::properties));
+
 void DoorEntity::OnEntitySpawned()
 {
-	// Loop through the doors properties and set stuff acoordingly.
-	for (auto& element : tiledProperties)
-	{
-		// Grab the name of this element.
-		auto name = element["name"].get < std::string >();
-
-		// Set our properties.
-		if (name == "level") levelDestination = element["value"].get< std::string >();
-		if (name == "landmark_entity") landmarkName = element["value"].get< std::string >();
-		if (name == "enabled") enabled = element["value"].get<bool>();
-	}
+	// Let us know when anything walks into us.
+	GameEngine->GetOverworldState()->gLevel->AddTrigger(this, { levelX, levelY, w(), h() });
 }
 
-void DoorEntity::Update(float dT)
+void DoorEntity::OnTriggerEnter(Entity* other)
 {
-	if (GameEngine->GetOverworldState()->gLevelTransData.transitionFlag) return;
-
-	// Grab our character entity.
-	Character* character = GameEngine->GetOverworldState()->gLevel->GetCharacter();
-
-	// Check to see if the character is colliding with us. If they are,
-	// perform our level transition.
-	if (CheckCollision(character))
+	// Only our character can go through doors.
+	if (!other->HasTag(Tag_Character)) return;
+	if (alreadyFaded || GameEngine->GetOverworldState()->gLevelTransData.transitionFlag) return;
+
+	// Don't let the character move anymore.
+	other->AddTag(Tag_DontMove);
+	alreadyFaded = true;
+
+	// Once we've faded out, set our level transition data in the engine so the engine knows what
+	// to do when the next Character entity spawns in. We might be deleted by then, so only hold onto our handle.
+	EntityHandle door = this->handle;
+	EngineResources.FadeToBlack(LEVEL_TRANSITION_FADE, [door]()
 	{
-		// Don't let the character move anymore.
-		character->AddTag("DontMove");
+		DoorEntity* self = door.GetAs<DoorEntity>();
+		if (self == nullptr) return;
 
-		if (!alreadyFaded) EngineResources.FadeToBlack(LEVEL_TRANSITION_FADE); alreadyFaded = true;
-		if (alreadyFaded && EngineResources.currentlyFading) return;
-
-		// Set our level transition data in the engine so the engine knows what
-		// to do when the next Character entity spawns in.
-		GameEngine->GetOverworldState()->gLevelTransData.landmark_name = this->landmarkName;
-		GameEngine->GetOverworldState()->gLevelTransData.new_level = this->levelDestination;
+		GameEngine->GetOverworldState()->gLevelTransData.landmark_name = self->properties.landmarkName;
+		GameEngine->GetOverworldState()->gLevelTransData.new_level = self->properties.levelDestination;
 		GameEngine->GetOverworldState()->gLevelTransData.transitionFlag = true;
-
-		// Exit, we'll be deleted soon.
-		return;
-	}
+	});
 }
\ No newline at end of file
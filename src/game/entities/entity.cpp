@@ -1,6 +1,12 @@
 #include "rpg/rpg.h"
 
+// As a landmark is a literal point on a map, we're not going to bother
+// with creating the nessacary overhead for this entity. Instead, we'll
+// just create a base entity instead and fill it's information with that.
+static EntityRegistration<Entity> landmarkRegistration("landmark");
+
 Entity::Entity()
 {
     this->AddTag(Tag_Entity);
+    handle = EntityRegistry::instance()->Register(this);
 }
\ No newline at end of file
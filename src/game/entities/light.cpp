@@ -0,0 +1,11 @@
+#include "rpg/rpg.h"
+#include "rpg/entities/light.h"
+
+static const PropertySchema<LightProperties> lightSchema = PropertySchema<LightProperties>()
+    .Add("color_r", &LightProperties::colorR)
+    .Add("color_g", &LightProperties::colorG)
+    .Add("color_b", &LightProperties::colorB)
+    .Add("intensity", &LightProperties::intensity)
+    .Add("shadows", &LightProperties::shadows);
+
+static EntityRegistration<Light> lightRegistration("light", lightSchema.Parser(&Light::properties));
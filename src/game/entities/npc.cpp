@@ -2,11 +2,22 @@
 #include "rpg/entities/npc.h"
 #include "rpg/states/overworld.h"
 
+static const PropertySchema<NPCProperties> npcSchema = PropertySchema<NPCProperties>()
+    .Add("npc_name", &NPCProperties::name)
+    .Add("npc_sprite", &NPCProperties::sprite)
+    .Add("npc_use_dist", &NPCProperties::useDistance)
+    .Add("npc_action_file", &NPCProperties::actionFile);
+
+static EntityRegistration<NPCEntity> npcRegistration("npc", npcSchema.Parser(&NPCEntity::properties));
+
 NPCEntity::NPCEntity() : Entity()
 {
     // This entity can collide with other entities.
     this->AddTag(Tag_Renderable);
     this->AddTag(Tag_Collision);
+
+    // We need to check on our textbox every frame.
+    this->hasScript = true;
 }
 
 NPCEntity::~NPCEntity()
@@ -15,18 +26,11 @@ NPCEntity::~NPCEntity()
 
 void NPCEntity::OnEntitySpawned()
 {
-    // Loop through the NPC's properties and set stuff acoordingly.
-    for (auto& element : tiledProperties)
-    {
-        // Grab the name of this element.
-        auto name = element["name"].get < std::string >();
-
-        // Set our properties.
-        if (name == "npc_name") npcName = element["value"].get< std::string >();
-        if (name == "npc_sprite") npctexture = EngineResources.textures.GetTexture(element["value"].get< std::string >());
-        if (name == "npc_use_dist") useDistance = element["value"].get< float >();
-        if (name == "npc_action_file") npcActions = GameEngine->LoadJSON(element["value"].get< std::string >());
-    }
+    // Our properties were decoded when the level was loaded, we just need to load what they point to.
+    npcName = properties.name;
+    useDistance = properties.useDistance;
+    if (!properties.sprite.empty()) npctexture = EngineResources.textures.GetTexture(properties.sprite);
+    if (!properties.actionFile.empty()) npcActions = GameEngine->LoadJSON(properties.actionFile);
 }
 
 void NPCEntity::Update(float dT)
@@ -41,7 +45,7 @@ void NPCEntity::Update(float dT)
         {
             GameEngine->GetOverworldState()->gGUI.RemoveElement(textbox->elementName, textbox->guiLayer);
             this->textbox.reset();
-            OnUseFinished(useActivator);
+            OnUseFinished(useActivator.Get());
         }
     }
 }
@@ -54,12 +58,12 @@ void NPCEntity::OnUse(Entity* activator)
         // file. If we do, perform some cool actions.
         if (npcActions.contains("onUse"))
         {
-            useActivator = activator;
+            useActivator = activator->handle;
 
             // If we're a character, stop moving us.
-            if (activator->HasTag("Character"))
+            if (activator->HasTag(Tag_Character))
             {
-                activator->AddTag("DontMove");
+                activator->AddTag(Tag_DontMove);
             }
 
             // Grab this object.
@@ -96,14 +100,22 @@ void NPCEntity::OnUse(Entity* activator)
 
 void NPCEntity::OnUseFinished(Entity* activator)
 {
+    useActivator = EntityHandle();
+
+    // Whoever used us might have been destroyed while we were talking.
+    if (activator == nullptr)
+    {
+        this->isCurrentlyUsed = false;
+        return;
+    }
+
     // If we're a character, allow movement.
-    if (activator->HasTag("Character"))
+    if (activator->HasTag(Tag_Character))
     {
-        activator->RemoveTag("DontMove");
+        activator->RemoveTag(Tag_DontMove);
         activator->isCurrentlyUsed = false;
         this->isCurrentlyUsed = false;
     }
-    useActivator = nullptr;
 }
 
 
@@ -111,6 +123,7 @@ void NPCEntity::Draw(SDL_Window* win, SDL_Renderer* ren)
 {
     // Render our character.
     Renderable::Draw(win, ren);
+    SDL_SetTextureColorMod(this->npctexture.get(), lighting.r, lighting.g, lighting.b);
     SDL_RenderCopyF(ren, this->npctexture.get(), NULL, &renderedRectangle);
     return;
 }
\ No newline at end of file
@@ -0,0 +1,76 @@
+#include "rpg/rpg.h"
+#include "rpg/level/components.h"
+
+EntityID ComponentStore::Add(Entity* entity, int layer)
+{
+	EntityID id = (EntityID)entities.size();
+	entity->entityID = id;
+
+	entities.push_back(entity);
+	positions.emplace_back();
+	sprites.emplace_back();
+	colliderIndices.push_back(-1);
+
+	// Only entities that collide get a collider.
+	if (entity->HasTag(Tag_Collision))
+	{
+		ColliderComponent collider;
+		collider.owner = id;
+		colliderIndices[id] = (int)colliders.size();
+		colliders.push_back(collider);
+	}
+
+	// Only entities with logic get a script.
+	if (entity->hasScript)
+	{
+		ScriptComponent script;
+		script.owner = id;
+		script.entity = entity;
+		scripts.push_back(script);
+	}
+
+	layers[layer].push_back(id);
+
+	Sync(id);
+	return id;
+}
+
+bool ComponentStore::Sync(EntityID id)
+{
+	Entity* entity = entities[id];
+	PositionComponent& position = positions[id];
+	SpriteComponent& sprite = sprites[id];
+
+	sprite.visible = entity->HasTag(Tag_Renderable) || !entity->HasTag(Tag_NotRendering);
+
+	if (position.x == entity->levelX && position.y == entity->levelY &&
+		sprite.w == entity->destinationRect.w && sprite.h == entity->destinationRect.h) return false;
+
+	position.x = entity->levelX;
+	position.y = entity->levelY;
+	sprite.w = entity->destinationRect.w;
+	sprite.h = entity->destinationRect.h;
+
+	ColliderComponent* collider = GetCollider(id);
+	if (collider != nullptr) collider->area = { position.x, position.y, sprite.w, sprite.h };
+
+	return true;
+}
+
+ColliderComponent* ComponentStore::GetCollider(EntityID id)
+{
+	int index = colliderIndices[id];
+	return index < 0 ? nullptr : &colliders[index];
+}
+
+void ComponentStore::Clear()
+{
+	entities.clear();
+	positions.clear();
+	sprites.clear();
+	colliders.clear();
+	scripts.clear();
+	colliderIndices.clear();
+
+	for (auto& layer : layers) layer.clear();
+}
@@ -1,7 +1,7 @@
 #include "rpg/rpg.h"
-#include "rpg/entities/npc.h"
-#include "rpg/entities/door.h"
 #include "rpg/entities/light.h"
+#include "rpg/level/lighting.h"
+#include "rpg/level/lightcache.h"
 #include "rpg/states/overworld.h"
 
 using json = nlohmann::json;
@@ -19,32 +19,23 @@ Level::~Level()
 	OverworldState::instance()->OnLevelShutdown();
 }
 
-// Grabs our character from our entity list.
+// Grabs our character. It's picked up as soon as it's added to the level, so there's nothing to look for.
 Character* Level::GetCharacter()
 {
-	for (auto& entityLayer : lEntities)
-	{
-		for (auto& entity : entityLayer)
-		{
-			if (entity->HasTag("Character"))
-			{
-				return dynamic_cast<Character*>(entity.get());
-			}
-		}
-	}
-	return nullptr;
+	return lCharacter.GetAs<Character>();
 }
 
 void Level::FreeResources()
 {
 	// Free all of our things.
+	for (auto& chunks : lTileChunks)
+	{
+		chunks.Free();
+	}
+
 	for (auto& layer : lTiles)
 	{
-		for (auto& tile : layer)
-		{
-			Tile *ptr = tile.release();
-			delete ptr;
-		}
+		layer.Free();
 	}
 
 	for (auto& layer : lEntities)
@@ -55,6 +46,19 @@ void Level::FreeResources()
 			delete ptr;
 		}
 	}
+
+	lCollisionR.clear();
+	lCollisionHash.Clear();
+	lComponents.Clear();
+	lEntityHash.Clear();
+	lMaxUseDistance = 0;
+	lTriggers.clear();
+	lTriggerHash.Clear();
+	lCharacter = EntityHandle();
+	lTargetnames.clear();
+	lClassnames.clear();
+	lLights.clear();
+	lPendingShadows.clear();
 }
 
 // Loads a level and populates it.
@@ -76,6 +80,14 @@ bool Level::LoadLevel(std::string levelPath)
 
 	// Create our collision.
 	CreateCollision(levelData);
+	MergeCollision();
+	BuildCollisionHash();
+
+	// Light our tiles, now that we know what can block our lights. If nothing has changed since
+	// the last time we loaded this level, the lighting we baked then is kept next to the level.
+	std::string cachePath = levelPath;
+	cachePath.replace(cachePath.find(".json"), std::string(".json").length(), ".lightcache");
+	CreateLighting(cachePath);
 	
 	std::cout << "[LEVEL] Created level " << levelPath << std::endl;
 	OverworldState::instance()->OnLevelLoaded();
@@ -118,30 +130,20 @@ bool Level::CreateTiles(json levelData)
 		tilesetSource = CleanupSourceImage(tilesetSource);
 
 		// Grab our tileset.
-		Tileset tileset = EngineResources.tilesets.GetTileset(tilesetSource);
+		Tileset* tileset = EngineResources.tilesets.GetTileset(tilesetSource);
+		if (tileset == nullptr)
+		{
+			std::cout << "[LEVELS] Tileset " << tilesetSource << " has not been loaded." << std::endl;
+			return false;
+		}
+
+		// All of our tiles are drawn from the tileset image.
+		auto tilesetTexture = EngineResources.textures.GetTexture(tileset->texture);
 
 		// Grab our layers and iterate over all of them.
 		auto levelLayers = levelData["layers"].get<std::vector<json>>();
 		int layerCount = 0;
 
-		// Grab all of our lights for lighting purposes.
-		std::vector<Light*> lights;
-
-		for (int l = 0; l < MAX_TILE_LAYERS; l++)
-		{
-			for (auto& entity : lEntities[l])
-			{
-				// Only deal with lights.
-				if (!entity->HasTag("Light")) continue;
-
-				// Convert entity to Light.
-				Light* light = dynamic_cast<Light*>(entity.get());
-
-				// Store it for later.
-				lights.push_back(light);
-			}
-		}
-
 		// Iterate over our vector and grab our data.
 		for (auto& layer : levelLayers)
 		{
@@ -160,65 +162,83 @@ bool Level::CreateTiles(json levelData)
 
 			// Get our tile data. This is stored in an array of ID's which is not split so
 			// we'll do it ourselves.
-			auto tiles = layer["data"].get<std::vector<int>>();
+			// Tiled writes these as unsigned, since flipped tiles use the top bit.
+			auto tiles = layer["data"].get<std::vector<Uint32>>();
 
 			int tileCount = 0;
+			int flippedTiles = 0;
+			int unknownTiles = 0;
+
+			// Set up our layer grid.
+			TileLayer& tileLayer = lTiles[layerCount];
+			tileLayer.width = layerWidth;
+			tileLayer.height = layerHeight;
+			tileLayer.x = (float)layerXOffset;
+			tileLayer.y = (float)layerYOffset;
+			tileLayer.tileset = tileset;
+			tileLayer.texture = tilesetTexture;
+			tileLayer.tiles.resize(layerWidth * layerHeight, 0);
 
 			for (int y = 0; y < layerHeight; y++)
 			{
 				for (int x = 0; x < layerWidth; x++)
 				{
-					float levelX = layerXOffset + 64 * x;
-					float levelY = layerYOffset + 64 * y;
+					float levelX = tileLayer.GetTileX(x);
+					float levelY = tileLayer.GetTileY(y);
+
+					// Grab our TileData via this tiles ID. Flipped and rotated tiles are drawn unflipped.
+					Uint32 tileID = tiles[tileCount];
+					if (tileID & TILE_FLIP_FLAGS)
+					{
+						tileID &= ~TILE_FLIP_FLAGS;
+						flippedTiles++;
+					}
 
-					// Grab our TileData via this tiles ID.
-					int tileID = tiles[tileCount];
+					// Tiles that our tileset doesn't know about (or that we can't store) are left blank.
+					if (tileID >= tileset->tiles.size() || tileID > UINT16_MAX)
+					{
+						tileID = 0;
+						unknownTiles++;
+					}
+					tileLayer.tiles[tileCount] = (Uint16)tileID;
 
 					// Grab the internally stored TileData.
-					TileData tileData = tileset.GetTile(tileID);
+					const TileData& tileData = tileset->GetTile(tileID);
 					
 					// If we have any collision data for this tile, create a new CollisionRect object
 					// and store it in our level collision list.
 					for (auto& tileCollisionObj : tileData.collisionRects)
 					{
 						CollisionRect collision;
-						collision.collisionRect = tileCollisionObj;
+						collision.rect = tileCollisionObj;
 
 						// These are offset from the topleft of the tile.
-						collision.levelX = levelX + tileCollisionObj.x;
-						collision.levelY = levelY + tileCollisionObj.y;
+						collision.rect.x = levelX + tileCollisionObj.x;
+						collision.rect.y = levelY + tileCollisionObj.y;
 
 						// Insert into our list.
 						lCollisionR.push_back(collision);
-;					}
-
-					// Construct a tile.
-					std::unique_ptr<Tile> tile(new Tile(levelX, levelY, tileData));
-
-					// Create our lighting for our tile.
-					// Loop over all of our lights and calculate lighting for this tile.
-					for (auto& light : lights)
-					{
-						SDL_Color lightColor = CalculateLightingFromEntityToTile(light, tile.get(), light->colorModifier, light->intensity);
-
-						tile->colorModifier.r = (int)std::min(tile->colorModifier.r + lightColor.r, 255);
-						tile->colorModifier.g = (int)std::min(tile->colorModifier.g + lightColor.g, 255);
-						tile->colorModifier.b = (int)std::min(tile->colorModifier.b + lightColor.b, 255);
-
-						//printf("Tile: %d, RGB: %d, %d, %d, Light RGB: %d, %d, %d, %d\n",
-						//	tileCount, tile->colorModifier.r, tile->colorModifier.g, tile->colorModifier.b,
-						//	light->colorModifier.r, light->colorModifier.g, light->colorModifier.b, light->intensity);
-
 					}
 
-					// Put our tile in our level list.
-					lTiles[layerCount].push_back(std::move(tile));
-
 					// Increment the tiles that we've gone through.
 					tileCount++;
 				}
 			}
 
+			if (flippedTiles > 0)
+			{
+				std::cout << "[LEVELS] " << flippedTiles << " flipped or rotated tiles on layer " << layerCount << " of " << levelName
+					<< " are drawn unflipped" << std::endl;
+			}
+			if (unknownTiles > 0)
+			{
+				std::cout << "[LEVELS] " << unknownTiles << " unknown tile IDs on layer " << layerCount << " of " << levelName
+					<< " were left blank" << std::endl;
+			}
+
+			// Split this layer up into chunks. These are drawn unlit, so they don't need to wait for our lighting.
+			lTileChunks[layerCount].Build(&tileLayer);
+
 			// Increment our layer count so we can store this.
 			layerCount++;
 		}
@@ -260,10 +280,10 @@ bool Level::CreateCollision(json levelData)
 				
 				// Construct our rectangle.
 				CollisionRect collision;
-				collision.levelX = object["x"].get<float>();
-				collision.levelY = object["y"].get<float>();
-				collision.collisionRect.w = object["width"].get<float>();
-				collision.collisionRect.h = object["height"].get<float>();
+				collision.rect.x = object["x"].get<float>();
+				collision.rect.y = object["y"].get<float>();
+				collision.rect.w = object["width"].get<float>();
+				collision.rect.h = object["height"].get<float>();
 
 				// Put it in our list of collision objects.
 				lCollisionR.push_back(collision);
@@ -280,6 +300,689 @@ bool Level::CreateCollision(json levelData)
 	return false;
 }
 
+// Merges rectangles that line up along one axis into one. Rectangles need to share the same
+// edges on the other axis, and touch or overlap along this one, so the area they cover
+// never changes. Returns true if anything was merged.
+static bool MergeCollisionAxis(std::vector<CollisionRect>& rects, bool horizontal)
+{
+	// Grab the position and size of a rectangle along the axis we're merging on, and the one we're not.
+	auto along = [horizontal](const CollisionRect& collision) { return horizontal ? collision.rect.x : collision.rect.y; };
+	auto alongSize = [horizontal](const CollisionRect& collision) { return horizontal ? collision.rect.w : collision.rect.h; };
+	auto across = [horizontal](const CollisionRect& collision) { return horizontal ? collision.rect.y : collision.rect.x; };
+	auto acrossSize = [horizontal](const CollisionRect& collision) { return horizontal ? collision.rect.h : collision.rect.w; };
+
+	// Sort so that rectangles that could be merged are right next to each other.
+	std::sort(rects.begin(), rects.end(), [&](const CollisionRect& a, const CollisionRect& b)
+	{
+		if (across(a) != across(b)) return across(a) < across(b);
+		if (acrossSize(a) != acrossSize(b)) return acrossSize(a) < acrossSize(b);
+		return along(a) < along(b);
+	});
+
+	std::vector<CollisionRect> merged;
+	merged.reserve(rects.size());
+
+	for (auto& rect : rects)
+	{
+		if (!merged.empty())
+		{
+			CollisionRect& last = merged.back();
+			if (across(last) == across(rect) && acrossSize(last) == acrossSize(rect) &&
+				along(rect) <= along(last) + alongSize(last))
+			{
+				// Stretch the last rectangle to cover this one too.
+				float end = std::max(along(last) + alongSize(last), along(rect) + alongSize(rect));
+				if (horizontal) last.rect.w = end - last.rect.x;
+				else last.rect.h = end - last.rect.y;
+				continue;
+			}
+		}
+
+		merged.push_back(rect);
+	}
+
+	bool changed = merged.size() != rects.size();
+	rects.swap(merged);
+	return changed;
+}
+
+// Checks that two sets of collision rectangles block exactly the same places. Every edge of every
+// rectangle (from both sets) splits the level up into a grid of cells, and no rectangle starts or
+// stops inside of a cell, so each cell is either completely blocked or completely open. If every
+// cell is blocked by both sets or by neither, anything that overlaps one set overlaps the other.
+static bool CollisionMatches(const std::vector<CollisionRect>& a, const std::vector<CollisionRect>& b)
+{
+	std::vector<float> edgesX, edgesY;
+	for (auto* rects : { &a, &b })
+	{
+		for (auto& collision : *rects)
+		{
+			edgesX.push_back(collision.rect.x);
+			edgesX.push_back(collision.rect.x + collision.rect.w);
+			edgesY.push_back(collision.rect.y);
+			edgesY.push_back(collision.rect.y + collision.rect.h);
+		}
+	}
+
+	std::sort(edgesX.begin(), edgesX.end());
+	std::sort(edgesY.begin(), edgesY.end());
+	edgesX.erase(std::unique(edgesX.begin(), edgesX.end()), edgesX.end());
+	edgesY.erase(std::unique(edgesY.begin(), edgesY.end()), edgesY.end());
+	if (edgesX.size() < 2 || edgesY.size() < 2) return a.empty() == b.empty();
+
+	int columns = (int)edgesX.size() - 1;
+	int rows = (int)edgesY.size() - 1;
+
+	// Count how many rectangles from each set block each cell.
+	auto cover = [&](const std::vector<CollisionRect>& rects)
+	{
+		std::vector<int> cells(columns * rows, 0);
+		for (auto& collision : rects)
+		{
+			int firstColumn = (int)(std::lower_bound(edgesX.begin(), edgesX.end(), collision.rect.x) - edgesX.begin());
+			int lastColumn = (int)(std::lower_bound(edgesX.begin(), edgesX.end(), collision.rect.x + collision.rect.w) - edgesX.begin());
+			int firstRow = (int)(std::lower_bound(edgesY.begin(), edgesY.end(), collision.rect.y) - edgesY.begin());
+			int lastRow = (int)(std::lower_bound(edgesY.begin(), edgesY.end(), collision.rect.y + collision.rect.h) - edgesY.begin());
+
+			for (int y = firstRow; y < lastRow; y++)
+			{
+				for (int x = firstColumn; x < lastColumn; x++)
+				{
+					cells[y * columns + x]++;
+				}
+			}
+		}
+		return cells;
+	};
+
+	std::vector<int> cellsA = cover(a);
+	std::vector<int> cellsB = cover(b);
+	for (int i = 0; i < columns * rows; i++)
+	{
+		if ((cellsA[i] > 0) != (cellsB[i] > 0)) return false;
+	}
+
+	return true;
+}
+
+// Bakes every light in the level into our tiles. This needs our collision, since lights can cast shadows.
+bool Level::CreateLighting(std::string cachePath)
+{
+	// Grab all of our lights for lighting purposes. Baking a light works out every color it can
+	// give off up front, so lighting a tile is just a lookup.
+	lLights.clear();
+	lPendingShadows.clear();
+
+	int shadowCount = 0;
+
+	for (int l = 0; l < MAX_TILE_LAYERS; l++)
+	{
+		for (auto& entity : lEntities[l])
+		{
+			// Only deal with lights.
+			if (!entity->HasTag(Tag_Light)) continue;
+
+			// Convert entity to Light.
+			Light* light = dynamic_cast<Light*>(entity.get());
+			if (light == nullptr) continue;
+
+			// Store it for later.
+			lLights.emplace_back(light);
+
+			// Make sure our tables match the real lighting, if we've asked to. Each color and intensity is
+			// only checked once.
+			if (CHECK_LIGHT_FALLOFF && GameEngine->debugModeEnabled && !CheckLightFalloffOnce(lLights.back().falloff))
+			{
+				std::cout << "[LEVEL] Light falloff table doesn't match the lighting calculations!" << std::endl;
+			}
+
+			if (lLights.back().NeedsShadow()) shadowCount++;
+		}
+	}
+
+	// Grab our lighting from the cache if we can. Shadows are only needed to take a light back out
+	// of our tiles, so they're left until a light changes.
+	Uint64 cacheStart = SDL_GetPerformanceCounter();
+	Uint64 hash = HashLighting();
+
+	if (LoadLightCache(cachePath, hash, lTiles.data(), (int)lTiles.size()))
+	{
+		double cacheTime = (SDL_GetPerformanceCounter() - cacheStart) * 1000.0 / SDL_GetPerformanceFrequency();
+		std::cout << "[LEVEL] Loaded lighting from " << cachePath << " in " << cacheTime << "ms" << std::endl;
+		return true;
+	}
+
+	// Find everything our lights can see before we bake them.
+	Uint64 shadowStart = SDL_GetPerformanceCounter();
+	BuildMissingShadows();
+
+	if (shadowCount > 0)
+	{
+		double shadowTime = (SDL_GetPerformanceCounter() - shadowStart) * 1000.0 / SDL_GetPerformanceFrequency();
+		std::cout << "[LEVEL] Built " << shadowCount << " shadows in " << shadowTime << "ms" << std::endl;
+	}
+
+	for (auto& tileLayer : lTiles)
+	{
+		if (tileLayer.tiles.empty()) continue;
+		int tileCount = (int)tileLayer.tiles.size();
+
+		// Tiles start off completely dark, lights are added on top of this.
+		tileLayer.light.assign(tileCount, { 0, 0, 0, 255 });
+
+		// The position of every tile, split into x and y so we can light several tiles at once.
+		std::vector<float> tileXs(tileCount);
+		std::vector<float> tileYs(tileCount);
+
+		for (int y = 0; y < tileLayer.height; y++)
+		{
+			for (int x = 0; x < tileLayer.width; x++)
+			{
+				tileXs[y * tileLayer.width + x] = tileLayer.GetTileX(x);
+				tileYs[y * tileLayer.width + x] = tileLayer.GetTileY(y);
+			}
+		}
+
+		// Light our tiles. Each part of the layer only looks at the lights that can reach it.
+		LightingKernel kernel = GetBestLightingKernel();
+		Uint64 bakeStart = SDL_GetPerformanceCounter();
+
+		LightGrid lightGrid;
+		lightGrid.Build(tileLayer, lLights);
+		BakeLayerLighting(tileLayer, lightGrid, lLights, tileXs.data(), tileYs.data(), kernel);
+
+		double bakeTime = (SDL_GetPerformanceCounter() - bakeStart) * 1000.0 / SDL_GetPerformanceFrequency();
+		std::cout << "[LEVEL] Lit " << tileCount << " tiles with " << lLights.size() << " lights in " << bakeTime
+			<< "ms (" << GetLightingKernelName(kernel) << ", " << WorkerPool::instance()->GetThreadCount() << " threads)" << std::endl;
+
+		// If we've asked to, make sure we get the exact same lighting by adding every light to every
+		// tile, one tile at a time.
+		if (CHECK_LIGHT_BAKE && GameEngine->debugModeEnabled)
+		{
+			std::vector<SDL_Color> scalarLight(tileCount, { 0, 0, 0, 255 });
+			for (auto& light : lLights)
+			{
+				BakeLight(light, tileXs.data(), tileYs.data(), scalarLight.data(), tileCount, LIGHTING_KERNEL_SCALAR);
+			}
+
+			if (memcmp(scalarLight.data(), tileLayer.light.data(), tileCount * sizeof(SDL_Color)) != 0)
+			{
+				std::cout << "[LEVEL] " << GetLightingKernelName(kernel) << " lighting doesn't match unculled scalar lighting!" << std::endl;
+			}
+		}
+	}
+
+	// Keep our lighting around for next time.
+	if (!SaveLightCache(cachePath, hash, lTiles.data(), (int)lTiles.size()))
+	{
+		std::cout << "[LEVEL] Failed to write lighting cache " << cachePath << std::endl;
+	}
+
+	return true;
+}
+
+// Hashes everything that changes how our tiles are lit.
+Uint64 Level::HashLighting()
+{
+	ContentHash hash;
+	bool anyShadows = false;
+
+	for (auto& tileLayer : lTiles)
+	{
+		hash.Add(tileLayer.width);
+		hash.Add(tileLayer.height);
+		hash.Add(tileLayer.x);
+		hash.Add(tileLayer.y);
+		hash.Add(tileLayer.tiles.data(), tileLayer.tiles.size() * sizeof(tileLayer.tiles[0]));
+	}
+
+	hash.Add(lLights.size());
+	for (auto& light : lLights)
+	{
+		SDL_Color color = light.falloff.GetColor();
+		hash.Add(light.x);
+		hash.Add(light.y);
+		hash.Add(color.r);
+		hash.Add(color.g);
+		hash.Add(color.b);
+		hash.Add(light.falloff.GetIntensity());
+		hash.Add(light.shadows);
+		anyShadows |= light.shadows;
+	}
+
+	// Collision only matters to lights that cast shadows.
+	if (anyShadows)
+	{
+		hash.Add(lCollisionR.size());
+		for (auto& collision : lCollisionR) hash.Add(collision.rect);
+	}
+
+	return hash.Get();
+}
+
+// Builds the shadow of every light that doesn't have one yet. Every light's shadow is separate,
+// so these can all be built at once.
+void Level::BuildMissingShadows()
+{
+	WorkerPool::instance()->Run((int)lLights.size(), [this](int index)
+	{
+		if (lLights[index].NeedsShadow()) BuildShadow(lLights[index]);
+	});
+}
+
+// Our light totals aren't kept around unless we need them, so the first time a light changes
+// we add up every light in the layer again.
+void Level::BuildLightTotals(TileLayer& tileLayer)
+{
+	if (!tileLayer.lightTotals.empty() || tileLayer.tiles.empty()) return;
+
+	// Our lighting might have come from a cache, in which case we haven't built our shadows yet.
+	BuildMissingShadows();
+
+	tileLayer.lightTotals.resize(tileLayer.tiles.size() * 3, 0);
+	for (auto& light : lLights)
+	{
+		AccumulateLight(tileLayer, light, 1);
+	}
+}
+
+// Works out the final colors of the tiles in an area. Our lightmap picks these up on the next frame.
+void Level::RelightArea(SDL_FRect area)
+{
+	for (auto& tileLayer : lTiles)
+	{
+		if (tileLayer.lightTotals.empty()) continue;
+		ResolveLight(tileLayer, area);
+	}
+}
+
+bool Level::SampleTileLight(float x, float y, SDL_Color& light)
+{
+	// Every layer is lit by the same lights, so the first layer with a tile here will do.
+	for (auto& tileLayer : lTiles)
+	{
+		int column, row;
+		if (tileLayer.tiles.empty() || !tileLayer.GetTileAt(x, y, column, row)) continue;
+
+		light = tileLayer.GetLight(column, row);
+		return true;
+	}
+
+	light = { 0, 0, 0, 255 };
+	return false;
+}
+
+void Level::AddLight(Light* light)
+{
+	if (light == nullptr) return;
+
+	// If we already have this light, it's just changed.
+	for (auto& baked : lLights)
+	{
+		if (baked.light == light)
+		{
+			UpdateLight(light);
+			return;
+		}
+	}
+
+	// Our totals need to be built before the light is in our list, otherwise it'd be added twice.
+	for (auto& tileLayer : lTiles) BuildLightTotals(tileLayer);
+
+	lLights.emplace_back(light);
+	BakedLight& baked = lLights.back();
+	if (baked.NeedsShadow()) BuildShadow(baked);
+
+	for (auto& tileLayer : lTiles)
+	{
+		if (tileLayer.lightTotals.empty()) continue;
+		AccumulateLight(tileLayer, baked, 1);
+	}
+
+	RelightArea(baked.GetArea());
+}
+
+void Level::RemoveLight(Light* light)
+{
+	auto baked = std::find_if(lLights.begin(), lLights.end(), [light](const BakedLight& baked) { return baked.light == light; });
+	if (baked == lLights.end()) return;
+
+	for (auto& tileLayer : lTiles)
+	{
+		BuildLightTotals(tileLayer);
+		if (tileLayer.lightTotals.empty()) continue;
+		AccumulateLight(tileLayer, *baked, -1);
+	}
+
+	SDL_FRect area = baked->GetArea();
+	lLights.erase(baked);
+	lPendingShadows.erase(std::remove(lPendingShadows.begin(), lPendingShadows.end(), light), lPendingShadows.end());
+	RelightArea(area);
+}
+
+void Level::UpdateLight(Light* light)
+{
+	auto baked = std::find_if(lLights.begin(), lLights.end(), [light](const BakedLight& baked) { return baked.light == light; });
+	if (baked == lLights.end())
+	{
+		AddLight(light);
+		return;
+	}
+
+	// Nothing to do if the light is exactly the same as when we baked it.
+	if (!baked->HasChanged()) return;
+
+	// Lights that haven't moved can keep their old shadow. Lights that have moved wait until we
+	// have time to rebuild it, and keep their old lighting until then.
+	if (baked->NeedsShadow()) BuildShadow(*baked);
+
+	BakedLight updated(light);
+	updated.shadow = baked->shadow;
+
+	if (updated.NeedsShadow())
+	{
+		if (std::find(lPendingShadows.begin(), lPendingShadows.end(), light) == lPendingShadows.end())
+		{
+			lPendingShadows.push_back(light);
+		}
+		return;
+	}
+
+	ReplaceLight(*baked, updated);
+}
+
+// Takes out what a light used to give us, and puts in what it gives us now.
+void Level::ReplaceLight(BakedLight& baked, const BakedLight& updated)
+{
+	for (auto& tileLayer : lTiles)
+	{
+		BuildLightTotals(tileLayer);
+		if (tileLayer.lightTotals.empty()) continue;
+
+		AccumulateLight(tileLayer, baked, -1);
+		AccumulateLight(tileLayer, updated, 1);
+	}
+
+	// Relight everywhere the light used to reach, and everywhere it reaches now.
+	SDL_FRect oldArea = baked.GetArea();
+	baked = updated;
+
+	RelightArea(oldArea);
+	RelightArea(updated.GetArea());
+}
+
+void Level::BuildShadow(BakedLight& light)
+{
+	// Grab every rectangle close enough to get in the way of our light.
+	SDL_FRect bounds = VisibilityPolygon::GetBounds(light.x, light.y, light.radius);
+
+	std::vector<CollisionRect*> collisions;
+	QueryCollision(bounds, collisions);
+
+	std::vector<SDL_FRect> occluders;
+	occluders.reserve(collisions.size());
+	for (auto& collision : collisions) occluders.push_back(collision->rect);
+
+	light.shadow = std::make_shared<VisibilityPolygon>();
+	light.shadow->Build(light.x, light.y, light.radius, occluders);
+}
+
+void Level::ProcessPendingShadows(double budget)
+{
+	if (lPendingShadows.empty()) return;
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	double elapsed = 0;
+	int processed = 0;
+
+	// Always rebuild at least one shadow, so lights can't get stuck waiting forever.
+	while (!lPendingShadows.empty() && (processed == 0 || elapsed < budget))
+	{
+		Light* light = lPendingShadows.front();
+		lPendingShadows.erase(lPendingShadows.begin());
+
+		auto baked = std::find_if(lLights.begin(), lLights.end(), [light](const BakedLight& baked) { return baked.light == light; });
+		if (baked != lLights.end())
+		{
+			BakedLight updated(light);
+			BuildShadow(updated);
+			ReplaceLight(*baked, updated);
+		}
+
+		processed++;
+		elapsed = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+	}
+
+	if (GameEngine->debugModeEnabled)
+	{
+		std::cout << "[LEVEL] Rebuilt " << processed << " shadows in " << elapsed << "ms, " << lPendingShadows.size() << " still waiting" << std::endl;
+	}
+}
+
+// Tiles each get their own collision rectangles, so a wall made out of 100 tiles gives us
+// 100 rectangles. Merge them into as few rectangles as we can by merging along rows and then
+// columns until nothing else can be merged.
+void Level::MergeCollision()
+{
+	size_t originalCount = lCollisionR.size();
+
+	// Keep the original rectangles around if we're checking that nothing changed.
+	std::vector<CollisionRect> original;
+	if (CHECK_COLLISION_MERGE && GameEngine->debugModeEnabled) original = lCollisionR;
+
+	bool changed = true;
+	while (changed)
+	{
+		changed = MergeCollisionAxis(lCollisionR, true);
+		changed |= MergeCollisionAxis(lCollisionR, false);
+	}
+
+	std::cout << "[LEVEL] Merged collision from " << originalCount << " to " << lCollisionR.size() << " rects, "
+		<< originalCount - lCollisionR.size() << " rects removed" << std::endl;
+
+	if (CHECK_COLLISION_MERGE && GameEngine->debugModeEnabled && !CollisionMatches(original, lCollisionR))
+	{
+		std::cout << "[LEVEL] Merged collision doesn't match the original collision!" << std::endl;
+	}
+}
+
+// Puts all of our collision rectangles into our spatial hash so we can quickly find the ones
+// near a point, rather than checking every single one.
+void Level::BuildCollisionHash()
+{
+	lCollisionHash.Clear();
+
+	for (int i = 0; i < (int)lCollisionR.size(); i++)
+	{
+		lCollisionHash.Insert(i, lCollisionR[i].rect);
+	}
+}
+
+void Level::SyncEntity(Entity* entity)
+{
+	if (entity->entityID < 0) return;
+
+	// Anything that doesn't depend on where the entity is has to be kept up to date even if it hasn't moved.
+	UpdateUseDistance(entity);
+
+	if (!lComponents.Sync(entity->entityID)) return;
+
+	IndexEntity(entity);
+	UpdateTriggers(entity);
+}
+
+bool Level::IndexEntity(Entity* entity)
+{
+	const PositionComponent& position = lComponents.positions[entity->entityID];
+	const SpriteComponent& sprite = lComponents.sprites[entity->entityID];
+	SDL_FRect area = { position.x, position.y, sprite.w, sprite.h };
+
+	// Most entities don't move, so most of the time there's nothing to do.
+	if (entity->isIndexed)
+	{
+		if (area.x == entity->indexedArea.x && area.y == entity->indexedArea.y &&
+			area.w == entity->indexedArea.w && area.h == entity->indexedArea.h) return false;
+
+		lEntityHash.Remove(entity, entity->indexedArea);
+	}
+
+	lEntityHash.Insert(entity, area);
+	entity->indexedArea = area;
+	entity->isIndexed = true;
+	return true;
+}
+
+void Level::UpdateUseDistance(Entity* entity)
+{
+	lMaxUseDistance = std::max(lMaxUseDistance, entity->useDistance);
+}
+
+bool Level::CheckUseDistances()
+{
+	bool usable = true;
+	for (auto& layer : lEntities)
+	{
+		for (auto& entity : layer)
+		{
+			if (entity == nullptr || entity->useDistance <= 0) continue;
+
+			// Stand just inside the entity's use distance and look around the same way our character does.
+			float x = entity->levelOriginX() + entity->useDistance * 0.5f;
+			float y = entity->levelOriginY();
+			std::vector<Entity*> nearby;
+			QueryEntitiesInRadius(x, y, lMaxUseDistance, nearby);
+
+			if (std::find(nearby.begin(), nearby.end(), entity.get()) == nearby.end())
+			{
+				std::cout << "[LEVEL] " << entity->targetname << " can't be used from inside its use distance!" << std::endl;
+				usable = false;
+			}
+		}
+	}
+	return usable;
+}
+
+int Level::AddTrigger(Entity* owner, SDL_FRect area)
+{
+	TriggerVolume trigger;
+	trigger.owner = owner->handle;
+	trigger.area = area;
+
+	lTriggers.push_back(trigger);
+	lTriggerHash.Insert((int)lTriggers.size() - 1, area);
+	return (int)lTriggers.size() - 1;
+}
+
+void Level::UpdateTriggers(Entity* entity)
+{
+	// Only entities that can collide with things set off triggers.
+	ColliderComponent* collider = lComponents.GetCollider(entity->entityID);
+	if (lTriggers.empty() || collider == nullptr) return;
+
+	// Grab every trigger we're inside of now. Our hash gives us these sorted, same as our old list.
+	SDL_FRect area = collider->area;
+	std::vector<int> touching;
+	lTriggerHash.Query(area, touching);
+	touching.erase(std::remove_if(touching.begin(), touching.end(), [this, entity, area](int index)
+	{
+		return lTriggers[index].owner == entity->handle || !SDL_FIntersectRect(lTriggers[index].area, area);
+	}), touching.end());
+
+	// Anything only in our old list has been left, and anything only in our new list has been entered.
+	std::vector<int> exited, entered;
+	std::set_difference(entity->touchingTriggers.begin(), entity->touchingTriggers.end(), touching.begin(), touching.end(), std::back_inserter(exited));
+	std::set_difference(touching.begin(), touching.end(), entity->touchingTriggers.begin(), entity->touchingTriggers.end(), std::back_inserter(entered));
+	entity->touchingTriggers.swap(touching);
+
+	// Owners that have been destroyed just stop hearing about their triggers.
+	for (auto& index : exited)
+	{
+		Entity* owner = lTriggers[index].owner.Get();
+		if (owner != nullptr) owner->OnTriggerExit(entity);
+	}
+	for (auto& index : entered)
+	{
+		Entity* owner = lTriggers[index].owner.Get();
+		if (owner != nullptr) owner->OnTriggerEnter(entity);
+	}
+}
+
+void Level::RegisterEntity(Entity* entity)
+{
+	lTargetnames[entity->targetname].push_back(entity->handle);
+	lClassnames[entity->classname].push_back(entity->handle);
+
+	if (entity->HasTag(Tag_Character)) lCharacter = entity->handle;
+}
+
+Entity* Level::FindEntity(const std::string& targetname, const std::string& classname)
+{
+	auto found = lTargetnames.find(targetname);
+	if (found == lTargetnames.end()) return nullptr;
+
+	for (auto& handle : found->second)
+	{
+		Entity* entity = handle.Get();
+		if (entity != nullptr && (classname.empty() || entity->classname == classname)) return entity;
+	}
+	return nullptr;
+}
+
+// Resolves every handle in a lookup, skipping any that have been destroyed.
+static void ResolveHandles(const std::unordered_map<std::string, std::vector<EntityHandle>>& lookup, const std::string& key, std::vector<Entity*>& out)
+{
+	auto found = lookup.find(key);
+	if (found == lookup.end()) return;
+
+	for (auto& handle : found->second)
+	{
+		Entity* entity = handle.Get();
+		if (entity != nullptr) out.push_back(entity);
+	}
+}
+
+void Level::FindEntitiesByName(const std::string& targetname, std::vector<Entity*>& out)
+{
+	ResolveHandles(lTargetnames, targetname, out);
+}
+
+void Level::FindEntitiesByClass(const std::string& classname, std::vector<Entity*>& out)
+{
+	ResolveHandles(lClassnames, classname, out);
+}
+
+void Level::QueryEntities(SDL_FRect area, std::vector<Entity*>& out)
+{
+	lEntityHash.Query(area, out);
+}
+
+void Level::QueryEntitiesInRadius(float x, float y, float radius, std::vector<Entity*>& out)
+{
+	std::vector<Entity*> nearby;
+	lEntityHash.Query({ x - radius, y - radius, radius * 2, radius * 2 }, nearby);
+
+	// Our hash only gives us entities that are roughly nearby. Comparing squared distances
+	// saves us a square root for every entity.
+	float radiusSquared = radius * radius;
+	for (auto& entity : nearby)
+	{
+		float distanceX = entity->levelOriginX() - x;
+		float distanceY = entity->levelOriginY() - y;
+		if (distanceX * distanceX + distanceY * distanceY <= radiusSquared) out.push_back(entity);
+	}
+}
+
+void Level::QueryCollision(SDL_FRect area, std::vector<CollisionRect*>& out)
+{
+	std::vector<int> indices;
+	lCollisionHash.Query(area, indices);
+
+	for (auto& index : indices)
+	{
+		out.push_back(&lCollisionR[index]);
+	}
+}
+
 // Loads a level and creates entities.
 bool Level::CreateEntities(json levelData)
 {
@@ -301,56 +1004,19 @@ bool Level::CreateEntities(json levelData)
 			auto objects = layer["objects"].get<std::vector<json>>();
 			for (auto& object : objects)
 			{
-				// Construct special entities depending on what type they are.
+				// Construct special entities depending on what type they are. Every type we can
+				// create has registered itself with the entity factory.
 				auto type = object["type"].get<std::string>();
+				const EntityType* entityType = EntityFactory::instance()->Find(type);
 
-				// Construct our entity.
-				std::unique_ptr<Entity> entity;
-
-				// Object is a character.
-				if (type == "character")
-				{
-					// If we already have a Character entity, ignore it.
-					if (GetCharacter() != nullptr) continue;
-
-					// Create a new Character entity.
-					std::unique_ptr<Entity> ptr(new Character());
-					entity.swap(ptr);
-				}
-
-				// Object is an NPC.
-				else if (type == "npc")
-				{
-					// Start constructing our NPC.
-					std::unique_ptr<Entity> ptr = std::make_unique<NPCEntity>();
-					entity.swap(ptr);
-				}
+				// This isn't an entity we recognize.
+				if (entityType == nullptr) continue;
 
-				// Object is a door.
-				else if (type == "door")
-				{
-					// Start constructing our door.
-					std::unique_ptr<Entity> ptr = std::make_unique<DoorEntity>();
-					entity.swap(ptr);
-				}
-				else if (type == "landmark")
-				{
-					// As this is a literal point on a map, we're not going to bother
-					// with creating the nessacary overhead for this entity. Instead, we'll
-					// just create a base entity instead and fill it's information with that.
-					std::unique_ptr<Entity> ptr = std::make_unique<Entity>();
-					entity.swap(ptr);
-				}
-				// Object is a light.
-				else if (type == "light")
-				{
-					// Start constructing our door.
-					std::unique_ptr<Entity> ptr = std::make_unique<Light>();
-					entity.swap(ptr);
-				}
+				// Some entities (like our Character) can only exist once. If we already have one, ignore it.
+				if (entityType->unique && lClassnames.find(entityType->classname) != lClassnames.end()) continue;
 
-				// This isn't an entity we recognize.
-				else continue;
+				// Construct our entity.
+				std::unique_ptr<Entity> entity = entityType->create();
 
 				// Set basic properties about our entity.
 				entity->classname = type;
@@ -360,12 +1026,19 @@ bool Level::CreateEntities(json levelData)
 				entity->destinationRect.w = object["width"].get<float>();
 				entity->destinationRect.h = object["height"].get<float>();
 
-				// Do we have any special properties?
-				if (object.contains("properties")) entity->tiledProperties = object["properties"].get<std::vector<json>>();
+				// Do we have any special properties? These are decoded once, here, and the JSON is
+				// thrown away with the rest of the level data.
+				if (entityType->parseProperties && object.contains("properties"))
+				{
+					entityType->parseProperties(entity.get(), object["properties"]);
+				}
 
 				entity->OnEntityCreated();
 
 				// Push our final entity to the list of entities.
+				lComponents.Add(entity.get(), layerCount);
+				IndexEntity(entity.get());
+				RegisterEntity(entity.get());
 				lEntities[layerCount].push_back(std::move(entity));
 				
 			}
@@ -381,6 +1054,30 @@ bool Level::CreateEntities(json levelData)
 	return false;
 }
 
+void Level::InvalidateTiles(SDL_FRect area)
+{
+	for (auto& chunks : lTileChunks)
+	{
+		chunks.Invalidate(area);
+	}
+}
+
+void Level::InvalidateAllTiles()
+{
+	for (auto& chunks : lTileChunks)
+	{
+		chunks.InvalidateAll();
+	}
+}
+
+void Level::ReleaseTileTextures()
+{
+	for (auto& chunks : lTileChunks)
+	{
+		chunks.ReleaseTextures();
+	}
+}
+
 std::string Level::CleanupSourceImage(std::string string)
 {
 	int stringIndex;
@@ -399,15 +1096,19 @@ std::string Level::CleanupSourceImage(std::string string)
 
 void Level::LevelUpdate(float dT)
 {
-	// For all of our entities, check collisions between them and
-	// collision rectangles and stuff.
-	
-	for (auto& entityLayer : lEntities)
+	// Only entities with scripts have anything to do every frame.
+	for (auto& script : lComponents.scripts)
 	{
-		for (auto& entity : entityLayer)
-		{
-			// Update all of our entities.
-			entity->Update(dT);
-		}
+		script.entity->Update(dT);
 	}
+
+	// Scripts are the only thing moving entities around during a frame, so they're all we need to
+	// sync. This keeps our index up to date with wherever they've moved to, and lets any triggers know.
+	for (auto& script : lComponents.scripts)
+	{
+		SyncEntity(script.entity);
+	}
+
+	// Catch up on any shadows that moved, without going over our budget for the frame.
+	ProcessPendingShadows(SHADOW_FRAME_BUDGET);
 }
\ No newline at end of file
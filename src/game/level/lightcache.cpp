@@ -0,0 +1,165 @@
+#include "rpg/rpg.h"
+#include "rpg/level/lightcache.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// The start of every cache file. The lighting of each layer comes after this, as a Uint32
+// count of tiles followed by the color of every tile.
+struct LightCacheHeader
+{
+	char magic[4];
+	Uint32 version;
+	Uint64 hash;
+	Uint32 layerCount;
+	Uint32 padding;
+};
+
+static const char lightCacheMagic[4] = { 'L', 'T', 'C', 'H' };
+
+bool MappedFile::Open(const std::string& path)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE) return false;
+	file = fileHandle;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+
+	HANDLE mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mappingHandle == NULL)
+	{
+		Close();
+		return false;
+	}
+	mapping = mappingHandle;
+
+	data = (const Uint8*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	size = (size_t)fileSize.QuadPart;
+#else
+	file = open(path.c_str(), O_RDONLY);
+	if (file < 0) return false;
+
+	struct stat fileInfo;
+	if (fstat(file, &fileInfo) != 0 || fileInfo.st_size == 0)
+	{
+		Close();
+		return false;
+	}
+
+	void* view = mmap(NULL, (size_t)fileInfo.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	data = view == MAP_FAILED ? nullptr : (const Uint8*)view;
+	size = (size_t)fileInfo.st_size;
+#endif
+
+	if (data == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (data != nullptr) UnmapViewOfFile(data);
+	if (mapping != nullptr) CloseHandle((HANDLE)mapping);
+	if (file != nullptr) CloseHandle((HANDLE)file);
+	mapping = nullptr;
+	file = nullptr;
+#else
+	if (data != nullptr) munmap((void*)data, size);
+	if (file >= 0) close(file);
+	file = -1;
+#endif
+
+	data = nullptr;
+	size = 0;
+}
+
+bool LoadLightCache(const std::string& path, Uint64 hash, TileLayer* layers, int layerCount)
+{
+	MappedFile cache;
+	if (!cache.Open(path)) return false;
+
+	// Make sure this cache was made for this exact level before we trust anything in it.
+	LightCacheHeader header;
+	if (cache.GetSize() < sizeof(header)) return false;
+	memcpy(&header, cache.GetData(), sizeof(header));
+
+	if (memcmp(header.magic, lightCacheMagic, sizeof(lightCacheMagic)) != 0 || header.version != LIGHT_CACHE_VERSION ||
+		header.hash != hash || header.layerCount != (Uint32)layerCount)
+	{
+		return false;
+	}
+
+	// Check that every layer is the right size before we copy anything.
+	size_t offset = sizeof(header);
+	for (int l = 0; l < layerCount; l++)
+	{
+		Uint32 tileCount;
+		if (offset + sizeof(tileCount) > cache.GetSize()) return false;
+		memcpy(&tileCount, cache.GetData() + offset, sizeof(tileCount));
+
+		if (tileCount != (Uint32)layers[l].tiles.size()) return false;
+		offset += sizeof(tileCount) + tileCount * sizeof(SDL_Color);
+		if (offset > cache.GetSize()) return false;
+	}
+
+	offset = sizeof(header);
+	for (int l = 0; l < layerCount; l++)
+	{
+		Uint32 tileCount;
+		memcpy(&tileCount, cache.GetData() + offset, sizeof(tileCount));
+		offset += sizeof(tileCount);
+
+		layers[l].light.resize(tileCount);
+		memcpy(layers[l].light.data(), cache.GetData() + offset, tileCount * sizeof(SDL_Color));
+		offset += tileCount * sizeof(SDL_Color);
+	}
+
+	return true;
+}
+
+bool SaveLightCache(const std::string& path, Uint64 hash, const TileLayer* layers, int layerCount)
+{
+	std::ofstream cache(path, std::ios::binary | std::ios::trunc);
+	if (!cache.is_open()) return false;
+
+	LightCacheHeader header = {};
+	memcpy(header.magic, lightCacheMagic, sizeof(lightCacheMagic));
+	header.version = LIGHT_CACHE_VERSION;
+	header.hash = hash;
+	header.layerCount = (Uint32)layerCount;
+	cache.write((const char*)&header, sizeof(header));
+
+	for (int l = 0; l < layerCount; l++)
+	{
+		Uint32 tileCount = (Uint32)layers[l].light.size();
+		cache.write((const char*)&tileCount, sizeof(tileCount));
+		cache.write((const char*)layers[l].light.data(), tileCount * sizeof(SDL_Color));
+	}
+
+	return cache.good();
+}
@@ -0,0 +1,436 @@
+#include "rpg/rpg.h"
+#include "rpg/entities/light.h"
+#include "rpg/level/lighting.h"
+
+#include <unordered_set>
+
+// SIMD kernels are only available on x86. Other platforms always use the scalar kernel.
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define LIGHTING_X86
+#include <immintrin.h>
+#endif
+
+// GCC and Clang need to be told which instruction sets a function can use. MSVC doesn't.
+#if defined(__GNUC__) || defined(__clang__)
+#define LIGHTING_TARGET(x) __attribute__((target(x)))
+#else
+#define LIGHTING_TARGET(x)
+#endif
+
+// The SIMD kernels work with floats, which only hold whole numbers exactly up to 2^24. Lights
+// with a radius bigger than this (about 4000 pixels) use the scalar kernel.
+#define LIGHTING_MAX_SIMD_RADIUS 4000
+
+void LightFalloff::Build(SDL_Color lightColor, int lightIntensity)
+{
+	color = lightColor;
+	intensity = lightIntensity;
+
+	// Lights are black past their radius, so that's all we need to store.
+	radius = std::max(0, (int)ceil(CalculateLightRadius(intensity)));
+	radiusSquared = (double)radius * radius;
+
+	table.resize(radius + 1);
+	for (int distance = 0; distance <= radius; distance++)
+	{
+		table[distance] = CalculateLightingFromLightDistance(distance, color, intensity);
+	}
+}
+
+bool BenchmarkLightFalloff(const LightFalloff& falloff)
+{
+	// Go a little past the radius so we know everything outside of it is black too.
+	int extent = falloff.GetRadius() + TILE_SIZE;
+	SDL_Color color = falloff.GetColor();
+	int intensity = falloff.GetIntensity();
+
+	// Add everything up so the compiler can't skip any of the work.
+	unsigned int tableTotal = 0, directTotal = 0;
+	int mismatches = 0;
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	for (int y = -extent; y <= extent; y++)
+	{
+		for (int x = -extent; x <= extent; x++)
+		{
+			SDL_Color light = falloff.Sample((float)x, (float)y);
+			tableTotal += light.r + light.g + light.b;
+		}
+	}
+	Uint64 tableTime = SDL_GetPerformanceCounter() - start;
+
+	start = SDL_GetPerformanceCounter();
+	for (int y = -extent; y <= extent; y++)
+	{
+		for (int x = -extent; x <= extent; x++)
+		{
+			SDL_Color light = CalculateLightingFromPositionToTile(0, 0, (float)x, (float)y, color, intensity);
+			directTotal += light.r + light.g + light.b;
+		}
+	}
+	Uint64 directTime = SDL_GetPerformanceCounter() - start;
+
+	// Now make sure every single result matches.
+	for (int y = -extent; y <= extent; y++)
+	{
+		for (int x = -extent; x <= extent; x++)
+		{
+			SDL_Color a = falloff.Sample((float)x, (float)y);
+			SDL_Color b = CalculateLightingFromPositionToTile(0, 0, (float)x, (float)y, color, intensity);
+			if (a.r != b.r || a.g != b.g || a.b != b.b || a.a != b.a) mismatches++;
+		}
+	}
+
+	double frequency = (double)SDL_GetPerformanceFrequency() / 1000.0;
+	std::cout << "[LEVEL] Light falloff (intensity " << intensity << "): table " << tableTime / frequency
+		<< "ms, direct " << directTime / frequency << "ms, " << mismatches << " mismatches" << std::endl;
+
+	return mismatches == 0 && tableTotal == directTotal;
+}
+
+bool CheckLightFalloffOnce(const LightFalloff& falloff)
+{
+	// A table only depends on its color and intensity, so once one has matched, every other table
+	// with the same color and intensity will too.
+	static std::unordered_set<Uint64> checked;
+	SDL_Color color = falloff.GetColor();
+	Uint64 key = ((Uint64)color.r << 56) | ((Uint64)color.g << 48) | ((Uint64)color.b << 40) | (Uint32)falloff.GetIntensity();
+	if (!checked.insert(key).second) return true;
+
+	return BenchmarkLightFalloff(falloff);
+}
+
+LightingKernel GetBestLightingKernel()
+{
+#ifdef LIGHTING_X86
+	static LightingKernel kernel = SDL_HasAVX2() ? LIGHTING_KERNEL_AVX2 : SDL_HasSSE2() ? LIGHTING_KERNEL_SSE2 : LIGHTING_KERNEL_SCALAR;
+	return kernel;
+#else
+	return LIGHTING_KERNEL_SCALAR;
+#endif
+}
+
+const char* GetLightingKernelName(LightingKernel kernel)
+{
+	switch (kernel)
+	{
+		case LIGHTING_KERNEL_AVX2: return "AVX2";
+		case LIGHTING_KERNEL_SSE2: return "SSE2";
+		default: return "scalar";
+	}
+}
+
+// Lights tiles one at a time, starting from index. This is used for whatever's left over by the
+// SIMD kernels too.
+static void BakeLightScalar(const LightFalloff& falloff, float lightX, float lightY, const float* tileX, const float* tileY,
+	SDL_Color* tileLight, int index, int count)
+{
+	for (int i = index; i < count; i++)
+	{
+		SDL_Color light = falloff.Sample(tileX[i] - lightX, tileY[i] - lightY);
+
+		tileLight[i].r = (int)std::min(tileLight[i].r + light.r, 255);
+		tileLight[i].g = (int)std::min(tileLight[i].g + light.g, 255);
+		tileLight[i].b = (int)std::min(tileLight[i].b + light.b, 255);
+	}
+}
+
+#ifdef LIGHTING_X86
+// SSE2 can't round floats up or down on its own, so we truncate and then fix up the result.
+LIGHTING_TARGET("sse2") static inline __m128 FloorSSE2(__m128 value)
+{
+	__m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(value));
+	return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, value), _mm_set1_ps(1.0f)));
+}
+
+LIGHTING_TARGET("sse2") static inline __m128 CeilSSE2(__m128 value)
+{
+	__m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(value));
+	return _mm_add_ps(truncated, _mm_and_ps(_mm_cmplt_ps(truncated, value), _mm_set1_ps(1.0f)));
+}
+
+// Lights 4 tiles at a time. Returns the index of the first tile that wasn't lit.
+LIGHTING_TARGET("sse2") static int BakeLightSSE2(const LightFalloff& falloff, float lightX, float lightY, const float* tileX, const float* tileY,
+	SDL_Color* tileLight, int count)
+{
+	const __m128 lightXs = _mm_set1_ps(lightX);
+	const __m128 lightYs = _mm_set1_ps(lightY);
+	const __m128 radiusSquared = _mm_set1_ps((float)falloff.GetRadiusSquared());
+	const __m128 one = _mm_set1_ps(1.0f);
+	const SDL_Color* table = falloff.GetTable();
+
+	alignas(16) int indices[4];
+	alignas(16) SDL_Color colors[4];
+
+	int i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		// Work out the squared distance from the light, just like LightFalloff::Sample.
+		__m128 x = FloorSSE2(_mm_sub_ps(_mm_loadu_ps(tileX + i), lightXs));
+		__m128 y = FloorSSE2(_mm_sub_ps(_mm_loadu_ps(tileY + i), lightYs));
+		__m128 distanceSquared = _mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y));
+
+		// Skip these tiles if the light can't reach any of them.
+		__m128 inRange = _mm_cmple_ps(distanceSquared, radiusSquared);
+		if (_mm_movemask_ps(inRange) == 0) continue;
+
+		// A float square root can round down to a whole number when the real root is just above it,
+		// so bump the distance up if it's too small.
+		__m128 distance = CeilSSE2(_mm_sqrt_ps(distanceSquared));
+		distance = _mm_add_ps(distance, _mm_and_ps(_mm_cmplt_ps(_mm_mul_ps(distance, distance), distanceSquared), one));
+
+		// Tiles that are out of range look up the first entry, and are then masked out.
+		__m128i index = _mm_and_si128(_mm_cvttps_epi32(distance), _mm_castps_si128(inRange));
+		_mm_store_si128((__m128i*)indices, index);
+		for (int lane = 0; lane < 4; lane++)
+		{
+			colors[lane] = table[indices[lane]];
+		}
+
+		__m128i light = _mm_and_si128(_mm_load_si128((const __m128i*)colors), _mm_castps_si128(inRange));
+		__m128i current = _mm_loadu_si128((const __m128i*)(tileLight + i));
+		_mm_storeu_si128((__m128i*)(tileLight + i), _mm_adds_epu8(current, light));
+	}
+
+	return i;
+}
+
+// Lights 8 tiles at a time. Returns the index of the first tile that wasn't lit.
+LIGHTING_TARGET("avx2") static int BakeLightAVX2(const LightFalloff& falloff, float lightX, float lightY, const float* tileX, const float* tileY,
+	SDL_Color* tileLight, int count)
+{
+	const __m256 lightXs = _mm256_set1_ps(lightX);
+	const __m256 lightYs = _mm256_set1_ps(lightY);
+	const __m256 radiusSquared = _mm256_set1_ps((float)falloff.GetRadiusSquared());
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const int* table = (const int*)falloff.GetTable();
+
+	int i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 x = _mm256_floor_ps(_mm256_sub_ps(_mm256_loadu_ps(tileX + i), lightXs));
+		__m256 y = _mm256_floor_ps(_mm256_sub_ps(_mm256_loadu_ps(tileY + i), lightYs));
+		__m256 distanceSquared = _mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y));
+
+		__m256 inRange = _mm256_cmp_ps(distanceSquared, radiusSquared, _CMP_LE_OQ);
+		if (_mm256_movemask_ps(inRange) == 0) continue;
+
+		__m256 distance = _mm256_ceil_ps(_mm256_sqrt_ps(distanceSquared));
+		distance = _mm256_add_ps(distance, _mm256_and_ps(_mm256_cmp_ps(_mm256_mul_ps(distance, distance), distanceSquared, _CMP_LT_OQ), one));
+
+		// Each SDL_Color is 4 bytes, so we can grab all 8 of them in one go. Tiles that are out of
+		// range are never read from and stay black.
+		__m256i mask = _mm256_castps_si256(inRange);
+		__m256i index = _mm256_and_si256(_mm256_cvttps_epi32(distance), mask);
+		__m256i light = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), table, index, mask, 4);
+
+		__m256i current = _mm256_loadu_si256((const __m256i*)(tileLight + i));
+		_mm256_storeu_si256((__m256i*)(tileLight + i), _mm256_adds_epu8(current, light));
+	}
+
+	return i;
+}
+#endif
+
+void BakeLight(const LightFalloff& falloff, float lightX, float lightY, const float* tileX, const float* tileY,
+	SDL_Color* tileLight, int count, LightingKernel kernel)
+{
+	int index = 0;
+
+#ifdef LIGHTING_X86
+	if (falloff.GetRadius() <= LIGHTING_MAX_SIMD_RADIUS)
+	{
+		if (kernel == LIGHTING_KERNEL_AVX2) index = BakeLightAVX2(falloff, lightX, lightY, tileX, tileY, tileLight, count);
+		else if (kernel == LIGHTING_KERNEL_SSE2) index = BakeLightSSE2(falloff, lightX, lightY, tileX, tileY, tileLight, count);
+	}
+#endif
+
+	BakeLightScalar(falloff, lightX, lightY, tileX, tileY, tileLight, index, count);
+}
+
+void BakeLight(const BakedLight& light, const float* tileX, const float* tileY, SDL_Color* tileLight, int count,
+	LightingKernel kernel)
+{
+	if (light.shadow == nullptr)
+	{
+		BakeLight(light.falloff, light.x, light.y, tileX, tileY, tileLight, count, kernel);
+		return;
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		// Looking up the color is much cheaper than checking the shadow, so do that first.
+		SDL_Color color = light.falloff.Sample(tileX[i] - light.x, tileY[i] - light.y);
+		if (color.r == 0 && color.g == 0 && color.b == 0) continue;
+		if (!light.shadow->IsTileVisible(tileX[i], tileY[i])) continue;
+
+		tileLight[i].r = (int)std::min(tileLight[i].r + color.r, 255);
+		tileLight[i].g = (int)std::min(tileLight[i].g + color.g, 255);
+		tileLight[i].b = (int)std::min(tileLight[i].b + color.b, 255);
+	}
+}
+
+BakedLight::BakedLight(Light* bakedLight)
+{
+	light = bakedLight;
+	x = light->levelX;
+	y = light->levelY;
+	radius = light->GetInfluenceRadius();
+	falloff.Build(light->colorModifier, light->intensity);
+	shadows = light->shadows;
+}
+
+bool BakedLight::HasChanged()
+{
+	SDL_Color color = falloff.GetColor();
+	return x != light->levelX || y != light->levelY || falloff.GetIntensity() != light->intensity ||
+		color.r != light->colorModifier.r || color.g != light->colorModifier.g || color.b != light->colorModifier.b;
+}
+
+bool BakedLight::NeedsShadow() const
+{
+	if (!shadows) return false;
+	return shadow == nullptr || shadow->x != x || shadow->y != y || shadow->radius != radius;
+}
+
+SDL_FRect BakedLight::GetArea() const
+{
+	// Positions are rounded down before working out the distance, which can make a tile
+	// look up to a pixel closer on each axis, so we pad our radius to be safe.
+	float padded = radius + 2;
+
+	// Lighting is worked out from the top left of each tile, so grab any tile whose top left is in range.
+	SDL_FRect area = { x - padded, y - padded, padded * 2 + 1, padded * 2 + 1 };
+	area.x -= TILE_SIZE - 1;
+	area.y -= TILE_SIZE - 1;
+	area.w += TILE_SIZE - 1;
+	area.h += TILE_SIZE - 1;
+	return area;
+}
+
+void LightGrid::Build(const TileLayer& layer, const std::vector<BakedLight>& lights)
+{
+	layerWidth = layer.width;
+	layerHeight = layer.height;
+	cellsWide = (layer.width + LIGHT_GRID_CELL_SIZE - 1) / LIGHT_GRID_CELL_SIZE;
+	cellsHigh = (layer.height + LIGHT_GRID_CELL_SIZE - 1) / LIGHT_GRID_CELL_SIZE;
+
+	cells.clear();
+	cells.resize(cellsWide * cellsHigh);
+
+	for (int i = 0; i < (int)lights.size(); i++)
+	{
+		const BakedLight& light = lights[i];
+		float radius = light.radius + 2;
+
+		// Grab every tile the light could reach.
+		int firstColumn, firstRow, lastColumn, lastRow;
+		if (!layer.GetTileRange(light.GetArea(), firstColumn, firstRow, lastColumn, lastRow)) continue;
+
+		for (int cellY = firstRow / LIGHT_GRID_CELL_SIZE; cellY <= lastRow / LIGHT_GRID_CELL_SIZE; cellY++)
+		{
+			for (int cellX = firstColumn / LIGHT_GRID_CELL_SIZE; cellX <= lastColumn / LIGHT_GRID_CELL_SIZE; cellX++)
+			{
+				int column, row, columns, rows;
+				GetCellTiles(cellX, cellY, column, row, columns, rows);
+
+				// Find the closest tile position in this cell to the light.
+				float left = layer.GetTileX(column), right = layer.GetTileX(column + columns - 1);
+				float top = layer.GetTileY(row), bottom = layer.GetTileY(row + rows - 1);
+				float x = std::max(left, std::min(light.x, right)) - light.x;
+				float y = std::max(top, std::min(light.y, bottom)) - light.y;
+
+				if (x * x + y * y <= radius * radius)
+				{
+					cells[cellY * cellsWide + cellX].push_back(i);
+				}
+			}
+		}
+	}
+}
+
+void LightGrid::GetCellTiles(int cellX, int cellY, int& column, int& row, int& columns, int& rows) const
+{
+	// Cells on the right and bottom edges of the layer might not be full.
+	column = cellX * LIGHT_GRID_CELL_SIZE;
+	row = cellY * LIGHT_GRID_CELL_SIZE;
+	columns = std::min(LIGHT_GRID_CELL_SIZE, layerWidth - column);
+	rows = std::min(LIGHT_GRID_CELL_SIZE, layerHeight - row);
+}
+
+// Lights a single row of tiles, one cell at a time.
+static void BakeLayerRow(TileLayer& layer, const LightGrid& grid, const std::vector<BakedLight>& lights,
+	const float* tileX, const float* tileY, LightingKernel kernel, int y)
+{
+	int cellY = y / LIGHT_GRID_CELL_SIZE;
+	for (int cellX = 0; cellX < grid.cellsWide; cellX++)
+	{
+		const std::vector<int>& cellLights = grid.GetLights(cellX, cellY);
+		if (cellLights.empty()) continue;
+
+		int column, row, columns, rows;
+		grid.GetCellTiles(cellX, cellY, column, row, columns, rows);
+
+		// Each row of a cell is next to each other in memory, so we light the whole thing at once.
+		int start = y * layer.width + column;
+		for (auto& index : cellLights)
+		{
+			BakeLight(lights[index], tileX + start, tileY + start, layer.light.data() + start, columns, kernel);
+		}
+	}
+}
+
+void BakeLayerLighting(TileLayer& layer, const LightGrid& grid, const std::vector<BakedLight>& lights,
+	const float* tileX, const float* tileY, LightingKernel kernel)
+{
+	// Every row only touches its own tiles, and always adds its lights in the same order, so we
+	// get the exact same lighting no matter how many threads we use or which thread gets which row.
+	WorkerPool::instance()->Run(layer.height, [&](int y)
+	{
+		BakeLayerRow(layer, grid, lights, tileX, tileY, kernel, y);
+	});
+}
+
+void AccumulateLight(TileLayer& layer, const BakedLight& light, int sign)
+{
+	int firstColumn, firstRow, lastColumn, lastRow;
+	if (!layer.GetTileRange(light.GetArea(), firstColumn, firstRow, lastColumn, lastRow)) return;
+
+	for (int row = firstRow; row <= lastRow; row++)
+	{
+		for (int column = firstColumn; column <= lastColumn; column++)
+		{
+			float tileX = layer.GetTileX(column);
+			float tileY = layer.GetTileY(row);
+
+			SDL_Color color = light.falloff.Sample(tileX - light.x, tileY - light.y);
+			if (color.r == 0 && color.g == 0 && color.b == 0) continue;
+			if (light.shadow != nullptr && !light.shadow->IsTileVisible(tileX, tileY)) continue;
+
+			// Totals aren't clamped to 255, so taking a light back out always gives us what we had before.
+			Uint16* total = &layer.lightTotals[(row * layer.width + column) * 3];
+			total[0] = (Uint16)std::clamp(total[0] + color.r * sign, 0, 65535);
+			total[1] = (Uint16)std::clamp(total[1] + color.g * sign, 0, 65535);
+			total[2] = (Uint16)std::clamp(total[2] + color.b * sign, 0, 65535);
+		}
+	}
+}
+
+void ResolveLight(TileLayer& layer, SDL_FRect area)
+{
+	int firstColumn, firstRow, lastColumn, lastRow;
+	if (!layer.GetTileRange(area, firstColumn, firstRow, lastColumn, lastRow)) return;
+
+	for (int row = firstRow; row <= lastRow; row++)
+	{
+		for (int column = firstColumn; column <= lastColumn; column++)
+		{
+			Uint16* total = &layer.lightTotals[(row * layer.width + column) * 3];
+			SDL_Color& light = layer.GetLight(column, row);
+
+			light.r = (Uint8)std::min((int)total[0], 255);
+			light.g = (Uint8)std::min((int)total[1], 255);
+			light.b = (Uint8)std::min((int)total[2], 255);
+		}
+	}
+}
@@ -0,0 +1,124 @@
+#include "rpg/rpg.h"
+#include "rpg/level/lightmap.h"
+
+bool TileLightmap::CreateTexture(SDL_Renderer* ren, int neededColumns, int neededRows)
+{
+	if (texture != nullptr && neededColumns <= textureWidth && neededRows <= textureHeight) return true;
+
+	// Leave a little room so we're not recreating this every time the camera moves.
+	int width = std::max(neededColumns, DEFAULT_SCREEN_WIDTH / TILE_SIZE + 2);
+	int height = std::max(neededRows, DEFAULT_SCREEN_HEIGHT / TILE_SIZE + 2);
+
+	SDL_Texture* newTexture = SDL_CreateTexture(ren, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING, width, height);
+	if (newTexture == NULL)
+	{
+		std::cout << "[LEVEL] Failed to create lightmap texture: " << SDL_GetError() << std::endl;
+		return false;
+	}
+
+	// Each pixel covers a whole tile, so it mustn't bleed into its neighbours.
+	SDL_SetTextureScaleMode(newTexture, SDL_ScaleModeNearest);
+
+	// Multiply both the color and the alpha of what's underneath. If the renderer can't do that,
+	// a plain multiply still gets our colors right but leaves unlit tiles black.
+	SDL_BlendMode multiply = SDL_ComposeCustomBlendMode(
+		SDL_BLENDFACTOR_ZERO, SDL_BLENDFACTOR_SRC_COLOR, SDL_BLENDOPERATION_ADD,
+		SDL_BLENDFACTOR_ZERO, SDL_BLENDFACTOR_SRC_ALPHA, SDL_BLENDOPERATION_ADD);
+
+	if (SDL_SetTextureBlendMode(newTexture, multiply) != 0)
+	{
+		SDL_SetTextureBlendMode(newTexture, SDL_BLENDMODE_MOD);
+	}
+
+	texture = std::shared_ptr<SDL_Texture>(newTexture, &DestroyTexturePointer);
+	textureWidth = width;
+	textureHeight = height;
+	return true;
+}
+
+bool TileLightmap::Update(SDL_Renderer* ren, TileLayer& layer, SDL_FRect camera, const std::vector<DynamicLight>& lights)
+{
+	int firstColumn, firstRow, lastColumn, lastRow;
+	if (!layer.GetTileRange(camera, firstColumn, firstRow, lastColumn, lastRow)) return false;
+
+	columns = lastColumn - firstColumn + 1;
+	rows = lastRow - firstRow + 1;
+	area = { layer.GetTileX(firstColumn), layer.GetTileY(firstRow), (float)(columns * TILE_SIZE), (float)(rows * TILE_SIZE) };
+
+	if (!CreateTexture(ren, columns, rows)) return false;
+
+	// Start off with our baked lighting.
+	light.resize(columns * rows);
+	for (int row = 0; row < rows; row++)
+	{
+		for (int column = 0; column < columns; column++)
+		{
+			light[row * columns + column] = layer.GetLight(firstColumn + column, firstRow + row);
+		}
+	}
+
+	// Add our dynamic lights, but only to the tiles they can actually reach.
+	for (auto& dynamic : lights)
+	{
+		float radius = (float)dynamic.falloff->GetRadius();
+		SDL_FRect lightArea = { dynamic.x - radius, dynamic.y - radius, radius * 2, radius * 2 };
+
+		int lightFirstColumn, lightFirstRow, lightLastColumn, lightLastRow;
+		if (!layer.GetTileRange(lightArea, lightFirstColumn, lightFirstRow, lightLastColumn, lightLastRow)) continue;
+
+		for (int row = std::max(lightFirstRow, firstRow); row <= std::min(lightLastRow, lastRow); row++)
+		{
+			for (int column = std::max(lightFirstColumn, firstColumn); column <= std::min(lightLastColumn, lastColumn); column++)
+			{
+				SDL_Color color = dynamic.falloff->Sample(layer.GetTileX(column) - dynamic.x, layer.GetTileY(row) - dynamic.y);
+				SDL_Color& tileLight = light[(row - firstRow) * columns + (column - firstColumn)];
+
+				tileLight.r = (int)std::min(tileLight.r + color.r, 255);
+				tileLight.g = (int)std::min(tileLight.g + color.g, 255);
+				tileLight.b = (int)std::min(tileLight.b + color.b, 255);
+			}
+		}
+	}
+
+	// Upload our lighting. Completely black tiles are made transparent so they're removed.
+	SDL_Rect region = { 0, 0, columns, rows };
+	void* pixels;
+	int pitch;
+	if (SDL_LockTexture(texture.get(), &region, &pixels, &pitch) != 0)
+	{
+		std::cout << "[LEVEL] Failed to lock lightmap texture: " << SDL_GetError() << std::endl;
+		return false;
+	}
+
+	for (int row = 0; row < rows; row++)
+	{
+		Uint32* line = (Uint32*)((Uint8*)pixels + row * pitch);
+		for (int column = 0; column < columns; column++)
+		{
+			SDL_Color& tileLight = light[row * columns + column];
+			Uint32 alpha = (tileLight.r == 0 && tileLight.g == 0 && tileLight.b == 0) ? 0 : 255;
+			line[column] = ((Uint32)tileLight.r << 24) | ((Uint32)tileLight.g << 16) | ((Uint32)tileLight.b << 8) | alpha;
+		}
+	}
+
+	SDL_UnlockTexture(texture.get());
+	return true;
+}
+
+void TileLightmap::Draw(SDL_Renderer* ren, SDL_FRect camera)
+{
+	if (texture == nullptr || columns == 0 || rows == 0) return;
+
+	SDL_Rect source = { 0, 0, columns, rows };
+	SDL_FRect destination = { area.x - camera.x, area.y - camera.y, area.w, area.h };
+	SDL_RenderCopyF(ren, texture.get(), &source, &destination);
+}
+
+void TileLightmap::Free()
+{
+	texture.reset();
+	textureWidth = 0;
+	textureHeight = 0;
+	columns = 0;
+	rows = 0;
+}
@@ -0,0 +1,157 @@
+#include "rpg/rpg.h"
+#include "rpg/level/shadows.h"
+
+#include <limits>
+
+// How far either side of a corner we cast extra rays, so we can see past the corner to whatever is behind it.
+#define SHADOW_CORNER_ANGLE 0.0001f
+
+// A single edge of a collision rectangle.
+struct ShadowSegment
+{
+	SDL_FPoint a;
+	SDL_FPoint b;
+};
+
+// Keeps an angle between -PI and PI.
+static float WrapAngle(float angle)
+{
+	if (angle > (float)M_PI) angle -= (float)(M_PI * 2);
+	if (angle < (float)-M_PI) angle += (float)(M_PI * 2);
+	return angle;
+}
+
+static void AddRectSegments(std::vector<ShadowSegment>& segments, SDL_FRect rect)
+{
+	SDL_FPoint topLeft = { rect.x, rect.y };
+	SDL_FPoint topRight = { rect.x + rect.w, rect.y };
+	SDL_FPoint bottomRight = { rect.x + rect.w, rect.y + rect.h };
+	SDL_FPoint bottomLeft = { rect.x, rect.y + rect.h };
+
+	segments.push_back({ topLeft, topRight });
+	segments.push_back({ topRight, bottomRight });
+	segments.push_back({ bottomRight, bottomLeft });
+	segments.push_back({ bottomLeft, topLeft });
+}
+
+SDL_FRect VisibilityPolygon::GetBounds(float lightX, float lightY, float lightRadius)
+{
+	// Tiles are checked a little way in from their edges, so we need to reach a couple of tiles past our radius.
+	float reach = lightRadius + TILE_SIZE * 2;
+	return { lightX - reach, lightY - reach, reach * 2, reach * 2 };
+}
+
+void VisibilityPolygon::Build(float lightX, float lightY, float lightRadius, const std::vector<SDL_FRect>& occluders)
+{
+	x = lightX;
+	y = lightY;
+	radius = lightRadius;
+	angles.clear();
+	points.clear();
+
+	// Our bounds make sure every ray hits something.
+	std::vector<ShadowSegment> segments;
+	AddRectSegments(segments, GetBounds(x, y, radius));
+
+	for (auto& rect : occluders)
+	{
+		if (x > rect.x && x < rect.x + rect.w && y > rect.y && y < rect.y + rect.h) continue;
+		AddRectSegments(segments, rect);
+	}
+
+	// Cast a ray at every corner, and just either side of it.
+	std::vector<float> rayAngles;
+	rayAngles.reserve(segments.size() * 3);
+	for (auto& segment : segments)
+	{
+		float angle = atan2f(segment.a.y - y, segment.a.x - x);
+		rayAngles.push_back(angle);
+		rayAngles.push_back(WrapAngle(angle - SHADOW_CORNER_ANGLE));
+		rayAngles.push_back(WrapAngle(angle + SHADOW_CORNER_ANGLE));
+	}
+
+	// Rectangles share corners with our bounds and each other, so get rid of any rays we've doubled up on.
+	std::sort(rayAngles.begin(), rayAngles.end());
+	rayAngles.erase(std::unique(rayAngles.begin(), rayAngles.end()), rayAngles.end());
+
+	angles.reserve(rayAngles.size());
+	points.reserve(rayAngles.size());
+
+	for (auto& angle : rayAngles)
+	{
+		float directionX = cosf(angle);
+		float directionY = sinf(angle);
+
+		// Find the closest edge along this ray.
+		float closest = std::numeric_limits<float>::max();
+		for (auto& segment : segments)
+		{
+			float edgeX = segment.b.x - segment.a.x;
+			float edgeY = segment.b.y - segment.a.y;
+
+			// Rays running along an edge can't hit it.
+			float denominator = directionX * edgeY - directionY * edgeX;
+			if (fabsf(denominator) < 0.000001f) continue;
+
+			float offsetX = segment.a.x - x;
+			float offsetY = segment.a.y - y;
+			float distance = (offsetX * edgeY - offsetY * edgeX) / denominator;
+			float along = (offsetX * directionY - offsetY * directionX) / denominator;
+
+			if (distance >= 0 && along >= 0 && along <= 1 && distance < closest) closest = distance;
+		}
+
+		// Our bounds surround the light, so this can only happen if a float has gone wrong.
+		if (closest == std::numeric_limits<float>::max()) continue;
+
+		angles.push_back(angle);
+		points.push_back({ x + directionX * closest, y + directionY * closest });
+	}
+}
+
+bool VisibilityPolygon::IsVisible(float pointX, float pointY) const
+{
+	if (points.size() < 3) return true;
+
+	float offsetX = pointX - x;
+	float offsetY = pointY - y;
+	if (offsetX == 0 && offsetY == 0) return true;
+
+	// Find the two points of our polygon either side of this point. The last and first points wrap around.
+	float angle = atan2f(offsetY, offsetX);
+	int next = (int)(std::upper_bound(angles.begin(), angles.end(), angle) - angles.begin());
+	if (next == (int)points.size()) next = 0;
+	int previous = (next == 0 ? (int)points.size() : next) - 1;
+
+	const SDL_FPoint& a = points[previous];
+	const SDL_FPoint& b = points[next];
+	float edgeX = b.x - a.x;
+	float edgeY = b.y - a.y;
+
+	// Both points hit the same spot, so the only thing that matters is how far away it is.
+	if (edgeX * edgeX + edgeY * edgeY < 0.0001f)
+	{
+		float hitX = a.x - x, hitY = a.y - y;
+		return offsetX * offsetX + offsetY * offsetY <= hitX * hitX + hitY * hitY;
+	}
+
+	// We can see the point if it's on the same side of the edge as the light.
+	float pointSide = edgeX * (pointY - a.y) - edgeY * (pointX - a.x);
+	float lightSide = edgeX * (y - a.y) - edgeY * (x - a.x);
+	return pointSide * lightSide >= 0;
+}
+
+bool VisibilityPolygon::IsTileVisible(float tileX, float tileY) const
+{
+	float centerX = tileX + TILE_SIZE / 2;
+	float centerY = tileY + TILE_SIZE / 2;
+
+	// Pull the center of the tile towards the light until it's just past the edge of the tile.
+	float offsetX = x - centerX;
+	float offsetY = y - centerY;
+	float distance = sqrtf(offsetX * offsetX + offsetY * offsetY);
+	float pull = TILE_SIZE / 2 + 1;
+	if (distance <= pull) return true;
+
+	return IsVisible(centerX + offsetX / distance * pull, centerY + offsetY / distance * pull);
+}
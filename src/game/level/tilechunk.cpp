@@ -0,0 +1,154 @@
+#include "rpg/rpg.h"
+#include "rpg/level/tilechunk.h"
+
+void TileChunkCache::Build(TileLayer* tileLayer)
+{
+	Free();
+
+	layer = tileLayer;
+	chunksWide = (layer->width + TILE_CHUNK_SIZE - 1) / TILE_CHUNK_SIZE;
+	chunksHigh = (layer->height + TILE_CHUNK_SIZE - 1) / TILE_CHUNK_SIZE;
+	chunks.resize(chunksWide * chunksHigh);
+
+	for (int y = 0; y < chunksHigh; y++)
+	{
+		for (int x = 0; x < chunksWide; x++)
+		{
+			TileChunk& chunk = chunks[y * chunksWide + x];
+
+			// Chunks on the right and bottom edges of the layer might not be full.
+			chunk.column = x * TILE_CHUNK_SIZE;
+			chunk.row = y * TILE_CHUNK_SIZE;
+			chunk.columns = std::min(TILE_CHUNK_SIZE, layer->width - chunk.column);
+			chunk.rows = std::min(TILE_CHUNK_SIZE, layer->height - chunk.row);
+
+			chunk.bounds.x = layer->x + (float)(chunk.column * TILE_SIZE);
+			chunk.bounds.y = layer->y + (float)(chunk.row * TILE_SIZE);
+			chunk.bounds.w = (float)(chunk.columns * TILE_SIZE);
+			chunk.bounds.h = (float)(chunk.rows * TILE_SIZE);
+		}
+	}
+}
+
+bool TileChunkCache::GetChunkRange(SDL_FRect area, int& firstColumn, int& firstRow, int& lastColumn, int& lastRow)
+{
+	if (layer == nullptr) return false;
+
+	// Find the tiles first, the chunks are just those divided by the size of a chunk.
+	if (!layer->GetTileRange(area, firstColumn, firstRow, lastColumn, lastRow)) return false;
+
+	firstColumn /= TILE_CHUNK_SIZE;
+	firstRow /= TILE_CHUNK_SIZE;
+	lastColumn /= TILE_CHUNK_SIZE;
+	lastRow /= TILE_CHUNK_SIZE;
+	return true;
+}
+
+void TileChunkCache::Invalidate(SDL_FRect area)
+{
+	int firstColumn, firstRow, lastColumn, lastRow;
+	if (!GetChunkRange(area, firstColumn, firstRow, lastColumn, lastRow)) return;
+
+	for (int y = firstRow; y <= lastRow; y++)
+	{
+		for (int x = firstColumn; x <= lastColumn; x++)
+		{
+			chunks[y * chunksWide + x].dirty = true;
+		}
+	}
+}
+
+void TileChunkCache::InvalidateAll()
+{
+	for (auto& chunk : chunks)
+	{
+		chunk.dirty = true;
+	}
+}
+
+void TileChunkCache::ReleaseTextures()
+{
+	for (auto& chunk : chunks)
+	{
+		chunk.texture.reset();
+		chunk.dirty = true;
+	}
+}
+
+bool TileChunkCache::RenderChunk(SDL_Renderer* ren, TileChunk& chunk)
+{
+	// Create the texture for this chunk if we haven't already.
+	if (chunk.texture == nullptr)
+	{
+		SDL_Texture* texture = SDL_CreateTexture(ren, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET,
+			(int)chunk.bounds.w, (int)chunk.bounds.h);
+
+		if (texture == NULL)
+		{
+			std::cout << "[LEVEL] Failed to create tile chunk texture: " << SDL_GetError() << std::endl;
+			return false;
+		}
+
+		SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+		chunk.texture = std::shared_ptr<SDL_Texture>(texture, &DestroyTexturePointer);
+	}
+
+	// Point the renderer at our chunk and clear it out.
+	SDL_Texture* oldTarget = SDL_GetRenderTarget(ren);
+	SDL_SetRenderTarget(ren, chunk.texture.get());
+	SDL_SetRenderDrawColor(ren, 0, 0, 0, 0);
+	SDL_RenderClear(ren);
+
+	batch.Begin(ren);
+	for (int y = chunk.row; y < chunk.row + chunk.rows; y++)
+	{
+		for (int x = chunk.column; x < chunk.column + chunk.columns; x++)
+		{
+			// Blank tiles have nothing to draw.
+			if (layer->GetTileID(x, y) == 0) continue;
+
+			// Draw our tile relative to the top left of the chunk. Lighting is added on top later.
+			SDL_FRect rect = { layer->GetTileX(x) - chunk.bounds.x, layer->GetTileY(y) - chunk.bounds.y, TILE_SIZE, TILE_SIZE };
+			batch.Add(layer->texture.get(), layer->GetTileData(x, y).rect, rect, { 255, 255, 255, 255 });
+		}
+	}
+	batch.End();
+
+	SDL_SetRenderTarget(ren, oldTarget);
+	chunk.dirty = false;
+	return true;
+}
+
+int TileChunkCache::Draw(SDL_Renderer* ren, SDL_FRect camera)
+{
+	int chunksDrawn = 0;
+
+	// Only look at the chunks that are in the camera's view.
+	int firstColumn, firstRow, lastColumn, lastRow;
+	if (!GetChunkRange(camera, firstColumn, firstRow, lastColumn, lastRow)) return 0;
+
+	for (int y = firstRow; y <= lastRow; y++)
+	{
+		for (int x = firstColumn; x <= lastColumn; x++)
+		{
+			TileChunk& chunk = chunks[y * chunksWide + x];
+
+			// Render our chunk again if something inside it has changed.
+			if (chunk.dirty && !RenderChunk(ren, chunk)) continue;
+
+			SDL_FRect rect = { chunk.bounds.x - camera.x, chunk.bounds.y - camera.y, chunk.bounds.w, chunk.bounds.h };
+			SDL_RenderCopyF(ren, chunk.texture.get(), NULL, &rect);
+			chunksDrawn++;
+		}
+	}
+
+	return chunksDrawn;
+}
+
+void TileChunkCache::Free()
+{
+	chunks.clear();
+	chunksWide = 0;
+	chunksHigh = 0;
+	layer = nullptr;
+}
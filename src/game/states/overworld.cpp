@@ -7,6 +7,9 @@
 OverworldState::OverworldState()
 {
    this->camera = { 0, 0, DEFAULT_SCREEN_WIDTH, DEFAULT_SCREEN_HEIGHT };
+
+   // Our mouse light never changes, so we only need to work out its falloff once.
+   this->mouseLight.Build(MOUSE_LIGHT_COLOR, MOUSE_LIGHT_INTENSITY);
 }
 
 // Wake up our entities and GUI elements once everything has been constructed.
@@ -24,6 +27,19 @@ void OverworldState::OnLevelLoaded()
         }
     }
 
+    // Entities can move around when they wake up. Now that every trigger has been added, pick up
+    // wherever they are. This also picks up use distances, which are only known once entities have
+    // spawned, even for entities that never move.
+    for (auto& entityLayer : this->gLevel->lEntities)
+    {
+        for (auto& entity : entityLayer)
+        {
+            this->gLevel->SyncEntity(entity.get());
+        }
+    }
+
+    if (GameEngine->debugModeEnabled) this->gLevel->CheckUseDistances();
+
     // Wake up our GUI elements.
     for (auto& guiLayer : gGUI.elements)
     {
@@ -90,27 +106,15 @@ void OverworldState::PerformLevelTransition()
 
     // Now that we've loaded in our level, we have access to all of our entities.
     // Find our level landmark and set our player position to be that point.
-    for (auto& entLayer : gLevel->lEntities)
+    Entity* landmark = gLevel->FindEntity(gLevelTransData.landmark_name, "landmark");
+    Character* character = gLevel->GetCharacter();
+    if (landmark != nullptr && character != nullptr)
     {
-        for (auto& entity : entLayer)
-        {
-            // Is this entity a landmark and has the required name?
-            if (entity->classname == "landmark" &&
-                entity->targetname == gLevelTransData.landmark_name)
-            {
-                // Set our Character position to the position of this landmark.
-                Character* character = gLevel->GetCharacter();
-                if (character != nullptr)
-                {
-                    // Do a little offset here so our position is at the origin
-                    // of the character sprite.
-                    character->ForcePosition(
-                        entity->levelX - (character->w() / 2),
-                        entity->levelY - (character->h() / 2));
-                }
-                break;
-            }
-        }
+        // Do a little offset here so our position is at the origin
+        // of the character sprite.
+        character->ForcePosition(
+            landmark->levelX - (character->w() / 2),
+            landmark->levelY - (character->h() / 2));
     }
 
     // Now that we've completed our level transition, reset our struct so we can
@@ -158,7 +162,7 @@ void OverworldState::Update(float dT)
         {
             // Update our text with information.
             std::stringstream fpsText;
-            element->SetText(std::to_string(floor(GameEngine->fps)));
+            element->SetText(std::to_string(floor(GameEngine->fps)) + " fps, " + std::to_string(tileDrawCalls) + " tile draw calls");
         }
     }
     else
@@ -200,105 +204,241 @@ bool CollisionCheckF(SDL_FRect a, SDL_FRect b)
     return true;
 }
 
-void OverworldState::Draw(SDL_Window* win, SDL_Renderer* ren)
+// Calculates the final lighting for a tile, which is its baked lighting plus the light
+// that follows our mouse around.
+SDL_Color OverworldState::CalculateTileLighting(TileLayer& tileLayer, int column, int row, float mouseX, float mouseY)
 {
-    if (!gLevel) return;
+    SDL_Color finalLight = mouseLight.Sample(tileLayer.GetTileX(column) - mouseX, tileLayer.GetTileY(row) - mouseY);
+    SDL_Color tileLight = tileLayer.GetLight(column, row);
+
+    // Add our existing tile color data.
+    finalLight.r = (int)std::min(tileLight.r + finalLight.r, 255);
+    finalLight.g = (int)std::min(tileLight.g + finalLight.g, 255);
+    finalLight.b = (int)std::min(tileLight.b + finalLight.b, 255);
+    return finalLight;
+}
+
+// Draws a tile layer one tile at a time. This is what we fall back on for the debug lighting
+// and culling views. Our tiles are still collected into one batch for the whole layer.
+void OverworldState::DrawTileLayer(SDL_Window* win, SDL_Renderer* ren, int layer, float mouseX, float mouseY)
+{
+    TileLayer& tileLayer = gLevel->lTiles[layer];
 
-    // Offset our collision rectangles by the camera.
-    for (auto& obj : gLevel->lCollisionR)
+    // Work out which tiles are in the camera's view. Our tiles are on a grid so we can
+    // go straight to them instead of checking every single tile.
+    int firstColumn = 0, firstRow = 0;
+    int lastColumn = tileLayer.width - 1, lastRow = tileLayer.height - 1;
+    if (this->tileCullingType == CULLING_STANDARD || this->tileCullingType == CULLING_NO_LIGHTS)
     {
-        obj.collisionRect.x = obj.levelX - this->camera.x;
-        obj.collisionRect.y = obj.levelY - this->camera.y;
+        if (!tileLayer.GetTileRange(this->camera, firstColumn, firstRow, lastColumn, lastRow)) return;
     }
 
-    // There can be up to 16 different layers for both entities and tiles. To allow for
-    // tiles to overlap entities (and vice versa), we'll render the tile layer FIRST and then
-    // render entities from the bottom 0 layer to the top layer 15.
-    for (int i = 0; i < MAX_TILE_LAYERS; i++)
+    tileBatch.Begin(ren);
+
+    for (int row = firstRow; row <= lastRow; row++)
     {
-        // Render our tiles.
-        for (auto& tile : gLevel->lTiles[i])
+        for (int column = firstColumn; column <= lastColumn; column++)
         {
-            // Manipulate the destinationRect of this tile to be offset by the camera.
-            tile->destinationRect.x = tile->levelX - this->camera.x;
-            tile->destinationRect.y = tile->levelY - this->camera.y;
+            // Blank tiles have nothing to draw.
+            if (tileLayer.GetTileID(column, row) == 0) continue;
 
-            SDL_FRect checkRect = { tile->levelX, tile->levelY, tile->destinationRect.w, tile->destinationRect.h };
+            // Offset our tile by the camera.
+            SDL_FRect rect = { tileLayer.GetTileX(column) - this->camera.x, tileLayer.GetTileY(row) - this->camera.y, TILE_SIZE, TILE_SIZE };
 
-            // Are we in the camera's view?
-            if (this->tileCullingType == CULLING_STANDARD || this->tileCullingType == CULLING_NO_LIGHTS)
+            // Calculate our lighting.
+            SDL_Color finalLight = CalculateTileLighting(tileLayer, column, row, mouseX, mouseY);
+
+            // If our tile is completely black, don't bother rendering it.
+            if (this->tileCullingType == CULLING_STANDARD)
             {
-                if (!CollisionCheckF(this->camera, checkRect)) continue;
+                if (finalLight.r == 0 && finalLight.g == 0 && finalLight.b == 0) continue;
             }
-            
-            // Call the tiles' render function.
-            if (tile->HasTag(Tag_Renderable) || !tile->HasTag(Tag_NotRendering))
+
+            // Are we rendering some debug properties?
+            switch (this->lightingRenderType)
             {
-                // Get the position of our mouse.
-                int x, y;
-                SDL_GetMouseState(&x, &y);
-                
-                // Calculate our lighting.
-                SDL_Color finalLight = CalculateLightingFromPositionToTile(x + this->camera.x, y + this->camera.y, tile.get(), { 255, 255, 255 }, 60);
-
-                // Add our existing tile color data.
-                finalLight.r = (int)std::min(tile->colorModifier.r + finalLight.r, 255);
-                finalLight.g = (int)std::min(tile->colorModifier.g + finalLight.g, 255);
-                finalLight.b = (int)std::min(tile->colorModifier.b + finalLight.b, 255);
-
-                // If our tile is completely black, don't bother rendering it.
-                if (this->tileCullingType == CULLING_STANDARD)
+                case LIGHTING_FILL: // Fills all tiles with just filled rectangles showing the light.
                 {
-                    if (finalLight.r == 0 && finalLight.g == 0 && finalLight.b == 0) continue;
+                    SDL_SetRenderDrawColor(ren, finalLight.r, finalLight.g, finalLight.b, 255);
+                    SDL_RenderFillRectF(ren, &rect);
+                    break;
                 }
-
-                // Are we rendering some debug properties?
-                switch (this->lightingRenderType)
+                case LIGHTING_BORDER:
                 {
-                    case LIGHTING_FILL: // Fills all tiles with just filled rectangles showing the light.
-                    {
-                        SDL_SetRenderDrawColor(ren, finalLight.r, finalLight.g, finalLight.b, 255);
-                        SDL_RenderFillRectF(ren, &tile->destinationRect);
-                        break;
-                    }
-                    case LIGHTING_BORDER:
-                    {
-                        SDL_SetRenderDrawColor(ren, finalLight.r, finalLight.g, finalLight.b, 255);
-                        SDL_RenderDrawRectF(ren, &tile->destinationRect);
-                        break;
-                    }
+                    SDL_SetRenderDrawColor(ren, finalLight.r, finalLight.g, finalLight.b, 255);
+                    SDL_RenderDrawRectF(ren, &rect);
+                    break;
                 }
+            }
 
-                SDL_SetTextureColorMod(tile->texture.get(), finalLight.r, finalLight.g, finalLight.b);
+            // Add our tile to the batch, scaled around its center.
+            rect.x += (rect.w / 2) - (rect.w / 2 * this->scaleMultiplier);
+            rect.y += (rect.h / 2) - (rect.h / 2 * this->scaleMultiplier);
+            rect.w *= this->scaleMultiplier;
+            rect.h *= this->scaleMultiplier;
 
-                // Draw our final tile.
-                tile->scaleMultiplier = this->scaleMultiplier;
-                tile->Draw(win, ren);
-            }
+            finalLight.a = 255;
+            tileBatch.Add(tileLayer.texture.get(), tileLayer.GetTileData(column, row).rect, rect, finalLight);
         }
+    }
 
-        // Render our entities.
-        for (auto& entity : gLevel->lEntities[i])
+    tileDrawCalls += tileBatch.End();
+}
+
+SDL_Color OverworldState::CalculateEntityLighting(Entity* entity, float mouseX, float mouseY)
+{
+    if (this->lightingRenderType == LIGHTING_DISABLED) return { 255, 255, 255, 255 };
+
+    // Start off with the baked lighting of the tile under the middle of the entity.
+    SDL_Color light;
+    gLevel->SampleTileLight(entity->levelX + (entity->w() / 2), entity->levelY + (entity->h() / 2), light);
+
+    // Add our dynamic lights on top.
+    SDL_Color mouseColor = CalculateLightingFromPositionToEntity(mouseX, mouseY, entity, MOUSE_LIGHT_COLOR, MOUSE_LIGHT_INTENSITY);
+    light.r = (int)std::min(light.r + mouseColor.r, 255);
+    light.g = (int)std::min(light.g + mouseColor.g, 255);
+    light.b = (int)std::min(light.b + mouseColor.b, 255);
+    light.a = 255;
+    return light;
+}
+
+// Grabs the texture we draw a tile layer into before lighting it, creating it if we need to.
+SDL_Texture* OverworldState::GetLayerTarget(SDL_Renderer* ren)
+{
+    if (layerTarget != nullptr) return layerTarget.get();
+
+    SDL_Texture* texture = SDL_CreateTexture(ren, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, (int)this->camera.w, (int)this->camera.h);
+    if (texture == NULL)
+    {
+        std::cout << "[OVERWORLD] Failed to create tile layer texture: " << SDL_GetError() << std::endl;
+        return nullptr;
+    }
+
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    layerTarget = std::shared_ptr<SDL_Texture>(texture, &DestroyTexturePointer);
+    return texture;
+}
+
+// Draws a tile layer using its pre-rendered (unlit) chunks, and then multiplies the whole
+// layer by a lightmap holding the baked lighting and our mouse light.
+void OverworldState::DrawTileLayerChunks(SDL_Window* win, SDL_Renderer* ren, int layer, float mouseX, float mouseY)
+{
+    TileLayer& tileLayer = gLevel->lTiles[layer];
+    if (tileLayer.tiles.empty()) return;
+
+    // Without any lighting, our chunks can go straight on screen.
+    if (this->lightingRenderType == LIGHTING_DISABLED)
+    {
+        tileDrawCalls += gLevel->lTileChunks[layer].Draw(ren, this->camera);
+        return;
+    }
+
+    // Work out the light of every tile we can see.
+    std::vector<DynamicLight> dynamicLights = { { &mouseLight, mouseX, mouseY } };
+    if (!tileLightmap.Update(ren, tileLayer, this->camera, dynamicLights)) return;
+
+    // If we can't draw the layer on its own, draw it one tile at a time instead.
+    SDL_Texture* target = GetLayerTarget(ren);
+    if (target == nullptr)
+    {
+        DrawTileLayer(win, ren, layer, mouseX, mouseY);
+        return;
+    }
+
+    // Draw our layer into its own texture and light it there, so the lightmap only touches our tiles.
+    SDL_Texture* oldTarget = SDL_GetRenderTarget(ren);
+    SDL_SetRenderTarget(ren, target);
+    SDL_SetRenderDrawColor(ren, 0, 0, 0, 0);
+    SDL_RenderClear(ren);
+
+    // Every chunk is one draw call, plus one for our lightmap and one for putting the layer on screen.
+    tileDrawCalls += gLevel->lTileChunks[layer].Draw(ren, this->camera) + 2;
+    tileLightmap.Draw(ren, this->camera);
+
+    SDL_SetRenderTarget(ren, oldTarget);
+    SDL_RenderCopy(ren, target, NULL, NULL);
+}
+
+void OverworldState::DrawCollision(SDL_Renderer* ren)
+{
+    // Collision is stored in level space, so only grab what the camera can see and move it on screen.
+    std::vector<CollisionRect*> visible;
+    gLevel->QueryCollision(this->camera, visible);
+
+    SDL_SetRenderDrawColor(ren, 255, 0, 0, 255);
+    for (auto& collision : visible)
+    {
+        SDL_FRect rect = { collision->rect.x - this->camera.x, collision->rect.y - this->camera.y, collision->rect.w, collision->rect.h };
+        SDL_RenderDrawRectF(ren, &rect);
+    }
+}
+
+void OverworldState::Draw(SDL_Window* win, SDL_Renderer* ren)
+{
+    if (!gLevel) return;
+
+    // Get the position of our mouse in the level.
+    int x, y;
+    SDL_GetMouseState(&x, &y);
+    float mouseX = x + this->camera.x;
+    float mouseY = y + this->camera.y;
+
+    // Chunks can only stand in for our tiles if we're drawing them normally. The debug views
+    // need every tile drawn (or not drawn) individually. Chunks are lit by our lightmap.
+    bool useChunks = this->tileCullingType == CULLING_STANDARD &&
+        (this->lightingRenderType == LIGHTING_STANDARD || this->lightingRenderType == LIGHTING_DISABLED) &&
+        this->scaleMultiplier == 1.0f && SDL_RenderTargetSupported(ren);
+
+    tileDrawCalls = 0;
+
+    // There can be up to 16 different layers for both entities and tiles. To allow for
+    // tiles to overlap entities (and vice versa), we'll render the tile layer FIRST and then
+    // render entities from the bottom 0 layer to the top layer 15.
+    for (int i = 0; i < MAX_TILE_LAYERS; i++)
+    {
+        // Render our tiles.
+        if (useChunks)
+        {
+            DrawTileLayerChunks(win, ren, i, mouseX, mouseY);
+        }
+        else
         {
-            // Manipulate the destinationRect of this tile to be offset by the camera.
-            entity->destinationRect.x = entity->levelX - this->camera.x;
-            entity->destinationRect.y = entity->levelY - this->camera.y;
+            DrawTileLayer(win, ren, i, mouseX, mouseY);
+        }
 
-            SDL_FRect checkRect = { entity->levelX, entity->levelY, entity->destinationRect.w, entity->destinationRect.h };
+        // Render our entities. Culling only needs their positions and sprites, so we only
+        // touch the entities we can actually see.
+        const ComponentStore& components = gLevel->lComponents;
+        for (auto& id : components.layers[i])
+        {
+            const PositionComponent& position = components.positions[id];
+            const SpriteComponent& sprite = components.sprites[id];
+            if (!sprite.visible) continue;
 
             // Are we in the camera's view?
+            SDL_FRect checkRect = { position.x, position.y, sprite.w, sprite.h };
             if (!CollisionCheckF(this->camera, checkRect)) continue;
 
-            // Call the entities render function.
-            if (entity->HasTag(Tag_Renderable) || !entity->HasTag(Tag_NotRendering))
-            {
-                // Draw our final entity.
-                entity->scaleMultiplier = this->scaleMultiplier;
-                entity->Draw(win, ren);
-            }
+            // Manipulate the destinationRect of this entity to be offset by the camera.
+            Entity* entity = components.entities[id];
+            entity->destinationRect.x = position.x - this->camera.x;
+            entity->destinationRect.y = position.y - this->camera.y;
+
+            // Light our entity. This is only done for entities we can see.
+            entity->lighting = CalculateEntityLighting(entity, mouseX, mouseY);
+
+            // Draw our final entity.
+            entity->scaleMultiplier = this->scaleMultiplier;
+            entity->Draw(win, ren);
         }
     }
 
+    // Show our collision on top of everything else when debugging.
+    if (GameEngine->debugModeEnabled)
+    {
+        DrawCollision(ren);
+    }
+
     // Render the GUI.
     for (auto& layer : gGUI.elements)
     {
@@ -324,6 +464,7 @@ void OverworldState::OnKeyboardInput(SDL_Keycode keyCode, bool pressed, bool rel
             case SDLK_ESCAPE: GameEngine->ChangeGameState(GameEngine->GetMainMenuState()); break;
             case SDLK_TAB: selection++; break;
             case SDLK_LSHIFT: selection--; break;
+            case SDLK_F5: if (GameEngine->debugModeEnabled) BenchmarkLighting(); break;
 
             case SDLK_1:
             {
@@ -369,13 +510,11 @@ void OverworldState::OnKeyboardInput(SDL_Keycode keyCode, bool pressed, bool rel
 
     if (gLevel != nullptr)
     {
-        // Tell all of our entities that a key has been pressed.
-        for (auto& entityLayer : gLevel->lEntities)
+        // Tell all of our entities that a key has been pressed. Only entities with scripts
+        // have any logic to do something about it.
+        for (auto& script : gLevel->lComponents.scripts)
         {
-            for (auto& entity : entityLayer)
-            {
-                entity->OnKeyboardInput(keyCode, pressed, !pressed, repeat);
-            }
+            script.entity->OnKeyboardInput(keyCode, pressed, !pressed, repeat);
         }
     }
 
@@ -395,3 +534,90 @@ void OverworldState::OffsetCamera(int x, int y)
     this->camera.x += x;
     this->camera.y += y;
 }
+
+void OverworldState::BenchmarkLighting()
+{
+    if (gLevel == nullptr) return;
+
+    // Lights with the same color and intensity share the same table, so only time each one once.
+    std::vector<const LightFalloff*> falloffs;
+    for (auto& light : gLevel->lLights)
+    {
+        auto same = std::find_if(falloffs.begin(), falloffs.end(), [&light](const LightFalloff* falloff)
+        {
+            SDL_Color a = falloff->GetColor(), b = light.falloff.GetColor();
+            return a.r == b.r && a.g == b.g && a.b == b.b && falloff->GetIntensity() == light.falloff.GetIntensity();
+        });
+        if (same == falloffs.end()) falloffs.push_back(&light.falloff);
+    }
+
+    int mismatched = 0;
+    for (auto& falloff : falloffs)
+    {
+        if (!BenchmarkLightFalloff(*falloff)) mismatched++;
+    }
+
+    std::cout << "[OVERWORLD] Benchmarked " << falloffs.size() << " light falloff tables, " << mismatched << " didn't match" << std::endl;
+}
+
+void OverworldState::OnRenderDeviceReset()
+{
+    layerTarget.reset();
+    tileLightmap.Free();
+    if (gLevel != nullptr) gLevel->ReleaseTileTextures();
+}
+
+// Runs a function on every light in our level with this name, and then relights them.
+static void ForEachLight(Level* level, const std::string& targetname, std::function<void(Light*)> function)
+{
+    if (level == nullptr) return;
+
+    std::vector<Entity*> entities;
+    level->FindEntitiesByName(targetname, entities);
+    for (auto& entity : entities)
+    {
+        if (!entity->HasTag(Tag_Light)) continue;
+
+        Light* light = dynamic_cast<Light*>(entity);
+        if (light == nullptr) continue;
+
+        function(light);
+        level->SyncEntity(light);
+        level->UpdateLight(light);
+    }
+}
+
+void OverworldState::SetLightColor(std::string targetname, int r, int g, int b)
+{
+    ForEachLight(gLevel, targetname, [r, g, b](Light* light) { light->colorModifier = { (Uint8)r, (Uint8)g, (Uint8)b, 255 }; });
+}
+
+void OverworldState::SetLightIntensity(std::string targetname, int intensity)
+{
+    ForEachLight(gLevel, targetname, [intensity](Light* light) { light->intensity = intensity; });
+}
+
+void OverworldState::SetLightPosition(std::string targetname, float x, float y)
+{
+    ForEachLight(gLevel, targetname, [x, y](Light* light) { light->levelX = x; light->levelY = y; });
+}
+
+EntityHandle OverworldState::FindEntity(std::string targetname)
+{
+    if (gLevel == nullptr) return EntityHandle();
+
+    Entity* entity = gLevel->FindEntity(targetname);
+    return entity != nullptr ? entity->handle : EntityHandle();
+}
+
+bool OverworldState::SetEntityPosition(EntityHandle handle, float x, float y)
+{
+    // Scripts might still be holding onto an entity from a level we've since left.
+    Entity* entity = handle.Get();
+    if (entity == nullptr || gLevel == nullptr) return false;
+
+    entity->levelX = x;
+    entity->levelY = y;
+    gLevel->SyncEntity(entity);
+    return true;
+}